@@ -0,0 +1,37 @@
+# Writes every shader in SHADERS ('|' separated) into OUTPUT as a C byte
+# array preceded by its length, so the executable doesn't have to find the
+# shader files at runtime.
+#
+#   cmake -DOUTPUT=embedded_shaders.h "-DSHADERS=a.vert|a.frag" -P embed_shaders.cmake
+#
+# shader.vert becomes shader_vert_length and shader_vert[]; the arrays are
+# not null-terminated.
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(CONTENT "/* generated by cmake/embed_shaders.cmake, do not edit */\n")
+set(CONTENT "${CONTENT}#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n")
+
+foreach(SHADER ${SHADERS})
+    get_filename_component(NAME ${SHADER} NAME)
+    string(MAKE_C_IDENTIFIER ${NAME} IDENTIFIER)
+    file(READ ${SHADER} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR LENGTH "${HEX_LENGTH} / 2")
+
+    if (LENGTH EQUAL 0)
+        set(BYTES "0")
+    else()
+        # 16 bytes to a line
+        string(REGEX REPLACE "(................................)" "\\1\n  " HEX "${HEX}")
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+        string(STRIP "${BYTES}" BYTES)
+    endif()
+
+    set(CONTENT "${CONTENT}\n/* ${NAME} */\n")
+    set(CONTENT "${CONTENT}static const unsigned int ${IDENTIFIER}_length = ${LENGTH};\n")
+    set(CONTENT "${CONTENT}static const unsigned char ${IDENTIFIER}[] = {\n  ${BYTES}\n};\n")
+endforeach()
+
+set(CONTENT "${CONTENT}\n#endif\n")
+file(WRITE ${OUTPUT} "${CONTENT}")
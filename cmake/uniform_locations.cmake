@@ -0,0 +1,71 @@
+# Gives every plain uniform declared in SHADERS ('|' separated) a fixed
+# location and writes them to OUTPUT as C constants and a table for
+# ExplicitUniforms_use. explicit_uniforms.h injects the same locations into
+# the sources as layout(location = N) when they are compiled, so a uniform
+# has one location in every program and across reloads.
+#
+#   cmake -DOUTPUT=uniform_locations.h "-DSHADERS=a.vert|a.frag" -P uniform_locations.cmake
+#
+# Only one-per-line declarations of a built-in type are picked up:
+#
+#   uniform float brightness;     -> UNIFORM_LOCATION_BRIGHTNESS 0
+#   uniform vec3 lights[4];       -> UNIFORM_LOCATION_LIGHTS 1, four slots
+#
+# Names are numbered in sorted order, so a uniform keeps its location in
+# every program of the exercise. Struct types, arrays sized by a macro and
+# declarations followed by a `// unpinned` comment are skipped and keep
+# driver-assigned locations; Shader_specialize can bake only those.
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(TYPE "(float|double|int|uint|bool|[biud]?vec[234]|d?mat[234](x[234])?|[iu]?sampler[0-9A-Za-z]+)")
+set(NAME "([A-Za-z_][A-Za-z0-9_]*)")
+
+set(NAMES "")
+foreach(SHADER ${SHADERS})
+    file(READ ${SHADER} TEXT)
+    # one list item per line; ';' and '[' would otherwise split or join items
+    string(REPLACE ";" "@" TEXT "${TEXT}")
+    string(REPLACE "[" "(" TEXT "${TEXT}")
+    string(REPLACE "]" ")" TEXT "${TEXT}")
+    string(REPLACE "\n" ";" LINES "${TEXT}")
+    foreach(LINE ${LINES})
+        if (NOT LINE MATCHES "@[ \t]*//[ \t]*unpinned")
+            if (LINE MATCHES "^[ \t]*uniform[ \t]+${TYPE}[ \t]+${NAME}[ \t]*(\\([ \t]*([0-9]+)[ \t]*\\))?[ \t]*@")
+                set(UNIFORM ${CMAKE_MATCH_3})
+                set(SLOTS 1)
+                if (CMAKE_MATCH_5)
+                    set(SLOTS ${CMAKE_MATCH_5})
+                endif()
+                # a name declared in several stages gets the largest size seen
+                if (NOT DEFINED SLOTS_${UNIFORM} OR SLOTS GREATER SLOTS_${UNIFORM})
+                    set(SLOTS_${UNIFORM} ${SLOTS})
+                endif()
+                list(APPEND NAMES ${UNIFORM})
+            endif()
+        endif()
+    endforeach()
+endforeach()
+if (NAMES)
+    list(REMOVE_DUPLICATES NAMES)
+    list(SORT NAMES)
+endif()
+
+set(CONTENT "/* generated by cmake/uniform_locations.cmake, do not edit */\n")
+set(CONTENT "${CONTENT}#ifndef UNIFORM_LOCATIONS_H\n#define UNIFORM_LOCATIONS_H\n\n")
+
+set(LOCATION 0)
+set(ENTRIES "")
+foreach(UNIFORM ${NAMES})
+    string(TOUPPER ${UNIFORM} UPPER)
+    set(CONTENT "${CONTENT}#define UNIFORM_LOCATION_${UPPER} ${LOCATION}\n")
+    set(ENTRIES "${ENTRIES} \\\n  X(${UNIFORM}, ${LOCATION}, ${SLOTS_${UNIFORM}})")
+    math(EXPR LOCATION "${LOCATION} + ${SLOTS_${UNIFORM}}")
+endforeach()
+
+list(LENGTH NAMES COUNT)
+set(CONTENT "${CONTENT}#define UNIFORM_LOCATION_COUNT ${COUNT}\n\n")
+set(CONTENT "${CONTENT}/* X(name, location, slots) for each uniform above */\n")
+set(CONTENT "${CONTENT}#define UNIFORM_LOCATIONS(X)${ENTRIES}\n")
+set(CONTENT "${CONTENT}\n#endif\n")
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -0,0 +1,171 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+/**
+ * File Watch
+ * ----------
+ * Non-blocking change notification for a set of files (inotify). The
+ * parent directory is watched rather than the file itself so editors that
+ * save by writing a temp file and renaming it over the original are still
+ * seen. Each watched file carries a tag that is handed back on change.
+ * On platforms without inotify every call is a no-op.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define FILE_WATCH_PATH_MAX 512
+
+typedef void (*FileWatchCallback)(void* tag, const char* path);
+
+bool FileWatch_add(const char* path, void* tag);
+void FileWatch_remove(void* tag);
+int FileWatch_poll(FileWatchCallback changed);
+/* utility functions */
+static bool splitWatchPath(const char* path, char* directory, char* name);
+
+struct WatchedFile {
+  int wd;
+  char name[FILE_WATCH_PATH_MAX];
+  char path[FILE_WATCH_PATH_MAX];
+  void* tag;
+};
+
+static struct {
+  int fd;
+  struct WatchedFile* files;
+  int count;
+  int capacity;
+} fileWatch = { -1, NULL, 0, 0 };
+
+bool FileWatch_add(const char* path, void* tag)
+{
+#ifdef __linux__
+  char directory[FILE_WATCH_PATH_MAX];
+  char name[FILE_WATCH_PATH_MAX];
+
+  if (fileWatch.fd == -1)
+  {
+    fileWatch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fileWatch.fd == -1)
+    {
+      perror("inotify_init1");
+      return false;
+    }
+  }
+  if (!splitWatchPath(path, directory, name))
+    return false;
+
+  /* inotify hands back the same descriptor for a directory watched twice */
+  int wd = inotify_add_watch(fileWatch.fd, directory,
+                             IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd == -1)
+  {
+    perror(directory);
+    return false;
+  }
+
+  if (fileWatch.count == fileWatch.capacity)
+  {
+    int capacity = fileWatch.capacity ? fileWatch.capacity * 2 : 16;
+    struct WatchedFile* files =
+      (struct WatchedFile*)realloc(fileWatch.files, capacity * sizeof(struct WatchedFile));
+    if (files == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    fileWatch.files = files;
+    fileWatch.capacity = capacity;
+  }
+  struct WatchedFile* file = &fileWatch.files[fileWatch.count++];
+  file->wd = wd;
+  snprintf(file->name, FILE_WATCH_PATH_MAX, "%s", name);
+  snprintf(file->path, FILE_WATCH_PATH_MAX, "%s", path);
+  file->tag = tag;
+  return true;
+#else
+  (void)path;
+  (void)tag;
+  return false;
+#endif
+}
+
+/* directory watches are kept; they are cheap and may be shared */
+void FileWatch_remove(void* tag)
+{
+  int kept = 0;
+  for (int i = 0; i < fileWatch.count; i++)
+    if (fileWatch.files[i].tag != tag)
+      fileWatch.files[kept++] = fileWatch.files[i];
+  fileWatch.count = kept;
+}
+
+/* drains pending events without blocking; returns how many callbacks ran */
+int FileWatch_poll(FileWatchCallback changed)
+{
+  int reported = 0;
+#ifdef __linux__
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  if (fileWatch.fd == -1)
+    return 0;
+
+  for (;;)
+  {
+    ssize_t length = read(fileWatch.fd, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      if (length == -1 && errno != EAGAIN)
+        perror("read");
+      break;
+    }
+    for (char* p = buffer; p < buffer + length; )
+    {
+      const struct inotify_event* event = (const struct inotify_event*)p;
+      p += sizeof(struct inotify_event) + event->len;
+      if (event->len == 0)
+        continue;
+      for (int i = 0; i < fileWatch.count; i++)
+      {
+        struct WatchedFile* file = &fileWatch.files[i];
+        if (file->wd == event->wd && strcmp(file->name, event->name) == 0)
+        {
+          changed(file->tag, file->path);
+          reported++;
+        }
+      }
+    }
+  }
+#else
+  (void)changed;
+#endif
+  return reported;
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+bool splitWatchPath(const char* path, char* directory, char* name)
+{
+  const char* slash = strrchr(path, '/');
+  if (slash == NULL)
+  {
+    snprintf(directory, FILE_WATCH_PATH_MAX, ".");
+    snprintf(name, FILE_WATCH_PATH_MAX, "%s", path);
+  }
+  else
+  {
+    int length = (int)(slash - path);
+    snprintf(directory, FILE_WATCH_PATH_MAX, "%.*s", length > 0 ? length : 1, path);
+    snprintf(name, FILE_WATCH_PATH_MAX, "%s", slash + 1);
+  }
+  return name[0] != '\0';
+}
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+/**
+ * Geometry Arena
+ * --------------
+ * One vertex buffer, one index buffer and one vertex array shared by every
+ * mesh of a vertex format. Meshes are ranges suballocated from the two
+ * buffers (first fit over a sorted free list, neighbours merged on
+ * release), and draws address them with an index offset plus a base
+ * vertex, so any number of meshes draw without a buffer or vertex array
+ * switch between them.
+ *
+ * Indices are 32-bit and relative to the mesh's own first vertex. A full
+ * buffer doubles in place on the GPU (glCopyBufferSubData), so ranges
+ * already handed out stay valid.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gl_state.h"
+#include "vertex_format.h"
+
+/* where a mesh lives in the arena, in vertices and indices */
+struct GeometryMesh {
+  int baseVertex;
+  unsigned int vertexCount;
+  unsigned int firstIndex;
+  unsigned int indexCount; /* 0 for meshes drawn without indices */
+};
+
+typedef struct GeometryArena_T* GeometryArena_T;
+
+GeometryArena_T GeometryArena_new(const struct VertexAttribute* attributes, int attributeCount,
+                                  unsigned int stride, unsigned int vertexCapacity,
+                                  unsigned int indexCapacity);
+void GeometryArena_free(GeometryArena_T arena);
+bool GeometryArena_upload(GeometryArena_T arena, const void* vertices, unsigned int vertexCount,
+                          const unsigned int* indices, unsigned int indexCount,
+                          struct GeometryMesh* mesh);
+void GeometryArena_release(GeometryArena_T arena, const struct GeometryMesh* mesh);
+unsigned int GeometryArena_vertexArray(GeometryArena_T arena);
+void GeometryArena_draw(GeometryArena_T arena, const struct GeometryMesh* mesh, GLenum mode);
+void GeometryArena_printStats(GeometryArena_T arena);
+/* utility functions */
+struct ArenaBuffer;
+static bool arenaAllocate(struct ArenaBuffer* buffer, unsigned int count, unsigned int* first);
+static void arenaFree(struct ArenaBuffer* buffer, unsigned int first, unsigned int count);
+static void arenaGrow(GeometryArena_T arena, struct ArenaBuffer* buffer, unsigned int needed);
+static void arenaSetupVertexArray(GeometryArena_T arena);
+
+/* a free range, in elements */
+struct ArenaRange {
+  unsigned int first;
+  unsigned int count;
+};
+
+/* a GL buffer and the free ranges in it, sorted by first */
+struct ArenaBuffer {
+  unsigned int ID;
+  unsigned int elementSize;
+  unsigned int capacity; /* elements */
+  unsigned int used;
+  struct ArenaRange* free;
+  int freeCount;
+  int freeCapacity;
+};
+
+struct GeometryArena_T {
+  unsigned int vertexArray;
+  struct ArenaBuffer vertices;
+  struct ArenaBuffer indices;
+  struct VertexAttribute* attributes;
+  int attributeCount;
+  int meshes;
+  int grows;
+};
+
+/* capacities are in vertices and indices; both buffers grow when full */
+GeometryArena_T GeometryArena_new(const struct VertexAttribute* attributes, int attributeCount,
+                                  unsigned int stride, unsigned int vertexCapacity,
+                                  unsigned int indexCapacity)
+{
+  GeometryArena_T arena = (GeometryArena_T)calloc(1, sizeof(struct GeometryArena_T));
+  if (arena == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  arena->attributes = (struct VertexAttribute*)malloc(attributeCount * sizeof(struct VertexAttribute));
+  if (arena->attributes == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(arena->attributes, attributes, attributeCount * sizeof(struct VertexAttribute));
+  arena->attributeCount = attributeCount;
+  arena->vertices.elementSize = stride;
+  arena->indices.elementSize = sizeof(unsigned int);
+
+  /* grown from nothing to the requested capacities */
+  glGenVertexArrays(1, &arena->vertexArray);
+  glGenBuffers(1, &arena->vertices.ID);
+  glGenBuffers(1, &arena->indices.ID);
+  arenaGrow(arena, &arena->vertices, vertexCapacity > 0 ? vertexCapacity : 1);
+  arenaGrow(arena, &arena->indices, indexCapacity > 0 ? indexCapacity : 1);
+  arena->grows = 0;
+  return arena;
+}
+
+void GeometryArena_free(GeometryArena_T arena)
+{
+  GLState_forget(arena->vertexArray);
+  GLState_forget(arena->vertices.ID);
+  GLState_forget(arena->indices.ID);
+  glDeleteVertexArrays(1, &arena->vertexArray);
+  glDeleteBuffers(1, &arena->vertices.ID);
+  glDeleteBuffers(1, &arena->indices.ID);
+  free(arena->vertices.free);
+  free(arena->indices.free);
+  free(arena->attributes);
+  free(arena);
+}
+
+/**
+ * Copies a mesh into the arena. indices may be NULL for a mesh drawn with
+ * glDrawArrays. Returns false, with mesh untouched, only for an empty mesh.
+*/
+bool GeometryArena_upload(GeometryArena_T arena, const void* vertices, unsigned int vertexCount,
+                          const unsigned int* indices, unsigned int indexCount,
+                          struct GeometryMesh* mesh)
+{
+  unsigned int firstVertex = 0, firstIndex = 0;
+  if (vertexCount == 0)
+    return false;
+  if (indices == NULL)
+    indexCount = 0;
+
+  if (!arenaAllocate(&arena->vertices, vertexCount, &firstVertex))
+  {
+    arenaGrow(arena, &arena->vertices, vertexCount);
+    arenaAllocate(&arena->vertices, vertexCount, &firstVertex);
+  }
+  if (indexCount > 0 && !arenaAllocate(&arena->indices, indexCount, &firstIndex))
+  {
+    arenaGrow(arena, &arena->indices, indexCount);
+    arenaAllocate(&arena->indices, indexCount, &firstIndex);
+  }
+
+  /* the copy target leaves the array and element bindings alone */
+  GLState_bindBuffer(GL_COPY_WRITE_BUFFER, arena->vertices.ID);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)firstVertex * arena->vertices.elementSize,
+                  (GLsizeiptr)vertexCount * arena->vertices.elementSize, vertices);
+  if (indexCount > 0)
+  {
+    GLState_bindBuffer(GL_COPY_WRITE_BUFFER, arena->indices.ID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)firstIndex * sizeof(unsigned int),
+                    (GLsizeiptr)indexCount * sizeof(unsigned int), indices);
+  }
+
+  mesh->baseVertex = (int)firstVertex;
+  mesh->vertexCount = vertexCount;
+  mesh->firstIndex = firstIndex;
+  mesh->indexCount = indexCount;
+  arena->meshes++;
+  return true;
+}
+
+/* the ranges may be reused by the next upload; don't draw the mesh again */
+void GeometryArena_release(GeometryArena_T arena, const struct GeometryMesh* mesh)
+{
+  arenaFree(&arena->vertices, (unsigned int)mesh->baseVertex, mesh->vertexCount);
+  if (mesh->indexCount > 0)
+    arenaFree(&arena->indices, mesh->firstIndex, mesh->indexCount);
+  arena->meshes--;
+}
+
+/* the one vertex array every mesh of the arena is drawn with */
+unsigned int GeometryArena_vertexArray(GeometryArena_T arena)
+{
+  return arena->vertexArray;
+}
+
+void GeometryArena_draw(GeometryArena_T arena, const struct GeometryMesh* mesh, GLenum mode)
+{
+  GLState_bindVertexArray(arena->vertexArray);
+  if (mesh->indexCount > 0)
+    glDrawElementsBaseVertex(mode, (GLsizei)mesh->indexCount, GL_UNSIGNED_INT,
+                             (const void*)((size_t)mesh->firstIndex * sizeof(unsigned int)),
+                             mesh->baseVertex);
+  else
+    glDrawArrays(mode, mesh->baseVertex, (GLsizei)mesh->vertexCount);
+}
+
+void GeometryArena_printStats(GeometryArena_T arena)
+{
+  printf("geometry arena: %d meshes, %u/%u vertices, %u/%u indices, %d grows\n",
+         arena->meshes, arena->vertices.used, arena->vertices.capacity,
+         arena->indices.used, arena->indices.capacity, arena->grows);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* first fit; the free list stays sorted */
+bool arenaAllocate(struct ArenaBuffer* buffer, unsigned int count, unsigned int* first)
+{
+  for (int i = 0; i < buffer->freeCount; i++)
+  {
+    struct ArenaRange* range = &buffer->free[i];
+    if (range->count < count)
+      continue;
+    *first = range->first;
+    range->first += count;
+    range->count -= count;
+    if (range->count == 0)
+    {
+      memmove(range, range + 1, (buffer->freeCount - i - 1) * sizeof(struct ArenaRange));
+      buffer->freeCount--;
+    }
+    buffer->used += count;
+    return true;
+  }
+  return false;
+}
+
+/* inserts the range in order and merges it with touching neighbours */
+void arenaFree(struct ArenaBuffer* buffer, unsigned int first, unsigned int count)
+{
+  int i = 0;
+  while (i < buffer->freeCount && buffer->free[i].first < first)
+    i++;
+  buffer->used -= count;
+
+  bool joinsPrevious = i > 0 && buffer->free[i - 1].first + buffer->free[i - 1].count == first;
+  bool joinsNext = i < buffer->freeCount && first + count == buffer->free[i].first;
+  if (joinsPrevious && joinsNext)
+  {
+    buffer->free[i - 1].count += count + buffer->free[i].count;
+    memmove(&buffer->free[i], &buffer->free[i + 1],
+            (buffer->freeCount - i - 1) * sizeof(struct ArenaRange));
+    buffer->freeCount--;
+    return;
+  }
+  if (joinsPrevious)
+  {
+    buffer->free[i - 1].count += count;
+    return;
+  }
+  if (joinsNext)
+  {
+    buffer->free[i].first = first;
+    buffer->free[i].count += count;
+    return;
+  }
+
+  if (buffer->freeCount == buffer->freeCapacity)
+  {
+    int capacity = buffer->freeCapacity ? 2 * buffer->freeCapacity : 16;
+    struct ArenaRange* ranges = (struct ArenaRange*)
+      realloc(buffer->free, capacity * sizeof(struct ArenaRange));
+    if (ranges == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    buffer->free = ranges;
+    buffer->freeCapacity = capacity;
+  }
+  memmove(&buffer->free[i + 1], &buffer->free[i],
+          (buffer->freeCount - i) * sizeof(struct ArenaRange));
+  buffer->free[i].first = first;
+  buffer->free[i].count = count;
+  buffer->freeCount++;
+}
+
+/**
+ * Doubles the buffer until needed more elements fit at its end, copying
+ * the old contents on the GPU, and points the vertex array at the new one.
+*/
+void arenaGrow(GeometryArena_T arena, struct ArenaBuffer* buffer, unsigned int needed)
+{
+  unsigned int oldCapacity = buffer->capacity;
+  unsigned int capacity = oldCapacity ? oldCapacity : needed;
+  while (capacity - oldCapacity < needed)
+    capacity *= 2;
+
+  unsigned int grown;
+  glGenBuffers(1, &grown);
+  GLState_bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity * buffer->elementSize, NULL,
+               GL_STATIC_DRAW);
+  if (oldCapacity > 0)
+  {
+    GLState_bindBuffer(GL_COPY_READ_BUFFER, buffer->ID);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        (GLsizeiptr)oldCapacity * buffer->elementSize);
+  }
+  GLState_forget(buffer->ID);
+  glDeleteBuffers(1, &buffer->ID);
+  buffer->ID = grown;
+  buffer->capacity = capacity;
+  arenaFree(buffer, oldCapacity, capacity - oldCapacity);
+  buffer->used += capacity - oldCapacity; /* arenaFree counted the new space as released */
+  arenaSetupVertexArray(arena);
+  arena->grows++;
+}
+
+/* the element binding belongs to the vertex array, so it is set there too */
+void arenaSetupVertexArray(GeometryArena_T arena)
+{
+  unsigned int previous = GLState_vertexArray();
+  GLState_bindVertexArray(arena->vertexArray);
+  GLState_bindBuffer(GL_ARRAY_BUFFER, arena->vertices.ID);
+  VertexFormat_setup(arena->attributes, arena->attributeCount, arena->vertices.elementSize);
+  GLState_bindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->indices.ID);
+  GLState_bindVertexArray(previous == GL_STATE_UNKNOWN ? 0 : previous);
+}
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+/**
+ * GL extensions
+ * -------------
+ * glad is generated for the plain 3.3 core profile, so anything newer is
+ * loaded here. Call GLExt_load right after gladLoadGL with the same loader;
+ * every GLEXT_* flag stays 0 when the driver lacks the feature and callers
+ * fall back to the 3.3 path.
+*/
+#include <glad/gl.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* GL_ARB_get_program_binary (core in 4.1) */
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+/* GL_KHR_parallel_shader_compile (ARB variant accepted as well) */
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+/* GL_ARB_separate_shader_objects (core in 4.1) */
+#define GL_VERTEX_SHADER_BIT 0x00000001
+#define GL_FRAGMENT_SHADER_BIT 0x00000002
+#define GL_PROGRAM_SEPARABLE 0x8258
+#define GL_PROGRAM_PIPELINE_BINDING 0x825A
+
+typedef GLuint (GLAD_API_PTR *PFNGLCREATESHADERPROGRAMVPROC)(GLenum type, GLsizei count, const GLchar* const* strings);
+typedef void (GLAD_API_PTR *PFNGLGENPROGRAMPIPELINESPROC)(GLsizei n, GLuint* pipelines);
+typedef void (GLAD_API_PTR *PFNGLDELETEPROGRAMPIPELINESPROC)(GLsizei n, const GLuint* pipelines);
+typedef void (GLAD_API_PTR *PFNGLBINDPROGRAMPIPELINEPROC)(GLuint pipeline);
+typedef void (GLAD_API_PTR *PFNGLUSEPROGRAMSTAGESPROC)(GLuint pipeline, GLbitfield stages, GLuint program);
+typedef void (GLAD_API_PTR *PFNGLVALIDATEPROGRAMPIPELINEPROC)(GLuint pipeline);
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMPIPELINEIVPROC)(GLuint pipeline, GLenum pname, GLint* params);
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMPIPELINEINFOLOGPROC)(GLuint pipeline, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+
+/* GL_ARB_explicit_uniform_location (core in 4.3): GLSL only, no entry points */
+
+/* GL_ARB_buffer_storage (core in 4.4) */
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#define GL_BUFFER_IMMUTABLE_STORAGE 0x821F
+#define GL_BUFFER_STORAGE_FLAGS 0x8220
+
+typedef void (GLAD_API_PTR *PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+int GLEXT_ARB_get_program_binary = 0;
+int GLEXT_KHR_parallel_shader_compile = 0;
+int GLEXT_ARB_separate_shader_objects = 0;
+int GLEXT_ARB_explicit_uniform_location = 0;
+int GLEXT_ARB_buffer_storage = 0;
+
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = NULL;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = NULL;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+PFNGLCREATESHADERPROGRAMVPROC glext_glCreateShaderProgramv = NULL;
+PFNGLGENPROGRAMPIPELINESPROC glext_glGenProgramPipelines = NULL;
+PFNGLDELETEPROGRAMPIPELINESPROC glext_glDeleteProgramPipelines = NULL;
+PFNGLBINDPROGRAMPIPELINEPROC glext_glBindProgramPipeline = NULL;
+PFNGLUSEPROGRAMSTAGESPROC glext_glUseProgramStages = NULL;
+PFNGLVALIDATEPROGRAMPIPELINEPROC glext_glValidateProgramPipeline = NULL;
+PFNGLGETPROGRAMPIPELINEIVPROC glext_glGetProgramPipelineiv = NULL;
+PFNGLGETPROGRAMPIPELINEINFOLOGPROC glext_glGetProgramPipelineInfoLog = NULL;
+#define glCreateShaderProgramv glext_glCreateShaderProgramv
+#define glGenProgramPipelines glext_glGenProgramPipelines
+#define glDeleteProgramPipelines glext_glDeleteProgramPipelines
+#define glBindProgramPipeline glext_glBindProgramPipeline
+#define glUseProgramStages glext_glUseProgramStages
+#define glValidateProgramPipeline glext_glValidateProgramPipeline
+#define glGetProgramPipelineiv glext_glGetProgramPipelineiv
+#define glGetProgramPipelineInfoLog glext_glGetProgramPipelineInfoLog
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = NULL;
+#define glBufferStorage glext_glBufferStorage
+
+bool GLExt_load(GLADloadfunc load);
+bool GLExt_has(const char* extension);
+/* utility functions */
+static bool hasCoreVersion(int major, int minor);
+
+bool GLExt_load(GLADloadfunc load)
+{
+  if (glGetStringi == NULL)
+    return false;
+
+  if (hasCoreVersion(4, 1) || GLExt_has("GL_ARB_get_program_binary"))
+  {
+    glext_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+    glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+    glext_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    GLEXT_ARB_get_program_binary = glext_glGetProgramBinary != NULL &&
+                                   glext_glProgramBinary != NULL &&
+                                   glext_glProgramParameteri != NULL;
+  }
+  if (GLExt_has("GL_KHR_parallel_shader_compile"))
+    glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+  else if (GLExt_has("GL_ARB_parallel_shader_compile"))
+    glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+  GLEXT_KHR_parallel_shader_compile = glext_glMaxShaderCompilerThreadsKHR != NULL;
+
+  if (hasCoreVersion(4, 1) || GLExt_has("GL_ARB_separate_shader_objects"))
+  {
+    glext_glCreateShaderProgramv = (PFNGLCREATESHADERPROGRAMVPROC)load("glCreateShaderProgramv");
+    glext_glGenProgramPipelines = (PFNGLGENPROGRAMPIPELINESPROC)load("glGenProgramPipelines");
+    glext_glDeleteProgramPipelines = (PFNGLDELETEPROGRAMPIPELINESPROC)load("glDeleteProgramPipelines");
+    glext_glBindProgramPipeline = (PFNGLBINDPROGRAMPIPELINEPROC)load("glBindProgramPipeline");
+    glext_glUseProgramStages = (PFNGLUSEPROGRAMSTAGESPROC)load("glUseProgramStages");
+    glext_glValidateProgramPipeline = (PFNGLVALIDATEPROGRAMPIPELINEPROC)load("glValidateProgramPipeline");
+    glext_glGetProgramPipelineiv = (PFNGLGETPROGRAMPIPELINEIVPROC)load("glGetProgramPipelineiv");
+    glext_glGetProgramPipelineInfoLog = (PFNGLGETPROGRAMPIPELINEINFOLOGPROC)load("glGetProgramPipelineInfoLog");
+    GLEXT_ARB_separate_shader_objects = glext_glCreateShaderProgramv != NULL &&
+                                        glext_glGenProgramPipelines != NULL &&
+                                        glext_glDeleteProgramPipelines != NULL &&
+                                        glext_glBindProgramPipeline != NULL &&
+                                        glext_glUseProgramStages != NULL &&
+                                        glext_glValidateProgramPipeline != NULL &&
+                                        glext_glGetProgramPipelineiv != NULL &&
+                                        glext_glGetProgramPipelineInfoLog != NULL;
+  }
+
+  GLEXT_ARB_explicit_uniform_location = hasCoreVersion(4, 3) ||
+                                        GLExt_has("GL_ARB_explicit_uniform_location");
+
+  if (hasCoreVersion(4, 4) || GLExt_has("GL_ARB_buffer_storage"))
+    glext_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+  GLEXT_ARB_buffer_storage = glext_glBufferStorage != NULL;
+  return true;
+}
+
+bool GLExt_has(const char* extension)
+{
+  int count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i = 0; i < count; i++)
+  {
+    const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+    if (name && strcmp(name, extension) == 0)
+      return true;
+  }
+  return false;
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+bool hasCoreVersion(int major, int minor)
+{
+  int currentMajor = 0, currentMinor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &currentMajor);
+  glGetIntegerv(GL_MINOR_VERSION, &currentMinor);
+  return currentMajor > major || (currentMajor == major && currentMinor >= minor);
+}
+
+#endif
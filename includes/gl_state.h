@@ -0,0 +1,329 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+/**
+ * GL State
+ * --------
+ * Shadows the bindings we change every frame (program, pipeline, vertex
+ * array, buffers, textures, framebuffers) and drops calls that would bind
+ * what is already bound. Hits and misses are counted per frame.
+ *
+ * The shadow starts out matching a fresh context. Anything that binds
+ * behind this layer's back must call GLState_invalidate afterwards, and
+ * deleted objects must be passed to GLState_forget since GL reuses names.
+ * The element array binding is part of the vertex array, so it is treated
+ * as unknown after every vertex array change.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gl_ext.h"
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+#define GL_STATE_TEXTURE_UNITS 16
+#define GL_STATE_UNIFORM_BINDINGS 16
+
+enum GLStateKind {
+  GL_STATE_PROGRAM,
+  GL_STATE_VERTEX_ARRAY,
+  GL_STATE_BUFFER,
+  GL_STATE_TEXTURE,
+  GL_STATE_FRAMEBUFFER,
+  GL_STATE_KINDS
+};
+
+void GLState_useProgram(unsigned int program);
+void GLState_bindProgramPipeline(unsigned int pipeline);
+void GLState_bindVertexArray(unsigned int vertexArray);
+void GLState_bindBuffer(GLenum target, unsigned int buffer);
+void GLState_bindBufferRange(GLenum target, unsigned int index, unsigned int buffer,
+                             GLintptr offset, GLsizeiptr size);
+void GLState_bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+void GLState_bindFramebuffer(GLenum target, unsigned int framebuffer);
+unsigned int GLState_program(void);
+unsigned int GLState_vertexArray(void);
+void GLState_forget(unsigned int name);
+void GLState_invalidate(void);
+void GLState_beginFrame(void);
+void GLState_printStats(void);
+/* utility functions */
+static bool stateChanged(enum GLStateKind kind, unsigned int* shadow, unsigned int value);
+static unsigned int* bufferShadow(GLenum target);
+static int textureSlot(GLenum target);
+
+/* the last range bound at an indexed uniform buffer binding point */
+struct BufferRange {
+  unsigned int buffer;
+  GLintptr offset;
+  GLsizeiptr size;
+};
+
+struct GLStateCounts {
+  unsigned long hits[GL_STATE_KINDS];
+  unsigned long misses[GL_STATE_KINDS];
+};
+
+/* zero is what a fresh context has bound everywhere */
+static struct {
+  unsigned int program;
+  unsigned int pipeline;
+  unsigned int vertexArray;
+  unsigned int arrayBuffer;
+  unsigned int elementBuffer;
+  unsigned int uniformBuffer;
+  struct BufferRange uniformRanges[GL_STATE_UNIFORM_BINDINGS];
+  unsigned int activeUnit;
+  unsigned int textures[GL_STATE_TEXTURE_UNITS][4]; /* see textureSlot */
+  unsigned int drawFramebuffer;
+  unsigned int readFramebuffer;
+  struct GLStateCounts frame;
+  struct GLStateCounts lastFrame;
+  struct GLStateCounts total;
+  unsigned long frames;
+} glState;
+
+void GLState_useProgram(unsigned int program)
+{
+  if (stateChanged(GL_STATE_PROGRAM, &glState.program, program))
+    glUseProgram(program);
+}
+
+/* only takes effect while no program is current, see ProgramPipeline_bind */
+void GLState_bindProgramPipeline(unsigned int pipeline)
+{
+  if (stateChanged(GL_STATE_PROGRAM, &glState.pipeline, pipeline))
+    glBindProgramPipeline(pipeline);
+}
+
+void GLState_bindVertexArray(unsigned int vertexArray)
+{
+  if (stateChanged(GL_STATE_VERTEX_ARRAY, &glState.vertexArray, vertexArray))
+  {
+    glBindVertexArray(vertexArray);
+    glState.elementBuffer = GL_STATE_UNKNOWN;
+  }
+}
+
+void GLState_bindBuffer(GLenum target, unsigned int buffer)
+{
+  unsigned int* shadow = bufferShadow(target);
+  if (shadow == NULL)
+  {
+    glState.frame.misses[GL_STATE_BUFFER]++;
+    glBindBuffer(target, buffer);
+  }
+  else if (stateChanged(GL_STATE_BUFFER, shadow, buffer))
+    glBindBuffer(target, buffer);
+}
+
+/* also sets the generic binding of target, like glBindBufferRange itself */
+void GLState_bindBufferRange(GLenum target, unsigned int index, unsigned int buffer,
+                             GLintptr offset, GLsizeiptr size)
+{
+  if (target == GL_UNIFORM_BUFFER && index < GL_STATE_UNIFORM_BINDINGS)
+  {
+    struct BufferRange* range = &glState.uniformRanges[index];
+    if (range->buffer == buffer && range->offset == offset && range->size == size)
+    {
+      glState.frame.hits[GL_STATE_BUFFER]++;
+      return;
+    }
+    range->buffer = buffer;
+    range->offset = offset;
+    range->size = size;
+  }
+  glState.frame.misses[GL_STATE_BUFFER]++;
+  glBindBufferRange(target, index, buffer, offset, size);
+  unsigned int* shadow = bufferShadow(target);
+  if (shadow)
+    *shadow = buffer;
+}
+
+void GLState_bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+  int slot = textureSlot(target);
+  if (unit < GL_STATE_TEXTURE_UNITS && slot != -1 &&
+      glState.textures[unit][slot] == texture)
+  {
+    glState.frame.hits[GL_STATE_TEXTURE]++;
+    return;
+  }
+  if (glState.activeUnit != unit)
+  {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glState.activeUnit = unit;
+  }
+  glState.frame.misses[GL_STATE_TEXTURE]++;
+  glBindTexture(target, texture);
+  if (unit < GL_STATE_TEXTURE_UNITS && slot != -1)
+    glState.textures[unit][slot] = texture;
+}
+
+void GLState_bindFramebuffer(GLenum target, unsigned int framebuffer)
+{
+  bool draw = target != GL_READ_FRAMEBUFFER;
+  bool read = target != GL_DRAW_FRAMEBUFFER;
+  if ((!draw || glState.drawFramebuffer == framebuffer) &&
+      (!read || glState.readFramebuffer == framebuffer))
+  {
+    glState.frame.hits[GL_STATE_FRAMEBUFFER]++;
+    return;
+  }
+  glState.frame.misses[GL_STATE_FRAMEBUFFER]++;
+  glBindFramebuffer(target, framebuffer);
+  if (draw)
+    glState.drawFramebuffer = framebuffer;
+  if (read)
+    glState.readFramebuffer = framebuffer;
+}
+
+/* the current program, asking the driver only if the shadow was dropped */
+unsigned int GLState_program(void)
+{
+  if (glState.program == GL_STATE_UNKNOWN)
+  {
+    int program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    glState.program = (unsigned int)program;
+  }
+  return glState.program;
+}
+
+unsigned int GLState_vertexArray(void)
+{
+  if (glState.vertexArray == GL_STATE_UNKNOWN)
+  {
+    int vertexArray = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+    glState.vertexArray = (unsigned int)vertexArray;
+  }
+  return glState.vertexArray;
+}
+
+/**
+ * Call after deleting an object. The name may be handed out again, and a
+ * deleted vertex array, buffer or framebuffer is unbound by GL, so any
+ * shadow still holding it is marked unknown.
+*/
+void GLState_forget(unsigned int name)
+{
+  unsigned int* shadows[] = {
+    &glState.pipeline, &glState.vertexArray, &glState.arrayBuffer,
+    &glState.elementBuffer, &glState.uniformBuffer,
+    &glState.drawFramebuffer, &glState.readFramebuffer,
+  };
+  if (name == 0)
+    return;
+  for (int i = 0; i < (int)(sizeof(shadows) / sizeof(shadows[0])); i++)
+    if (*shadows[i] == name)
+      *shadows[i] = GL_STATE_UNKNOWN;
+  for (int i = 0; i < GL_STATE_UNIFORM_BINDINGS; i++)
+    if (glState.uniformRanges[i].buffer == name)
+      glState.uniformRanges[i].buffer = GL_STATE_UNKNOWN;
+  for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+    for (int slot = 0; slot < 4; slot++)
+      if (glState.textures[unit][slot] == name)
+        glState.textures[unit][slot] = GL_STATE_UNKNOWN;
+  /* a deleted program stays current until something else is bound */
+}
+
+/* after GL calls made around this layer; the next bind of each kind is issued */
+void GLState_invalidate(void)
+{
+  glState.program = GL_STATE_UNKNOWN;
+  glState.pipeline = GL_STATE_UNKNOWN;
+  glState.vertexArray = GL_STATE_UNKNOWN;
+  glState.arrayBuffer = GL_STATE_UNKNOWN;
+  glState.elementBuffer = GL_STATE_UNKNOWN;
+  glState.uniformBuffer = GL_STATE_UNKNOWN;
+  for (int i = 0; i < GL_STATE_UNIFORM_BINDINGS; i++)
+    glState.uniformRanges[i].buffer = GL_STATE_UNKNOWN;
+  glState.activeUnit = GL_STATE_UNKNOWN;
+  memset(glState.textures, 0xFF, sizeof(glState.textures));
+  glState.drawFramebuffer = GL_STATE_UNKNOWN;
+  glState.readFramebuffer = GL_STATE_UNKNOWN;
+}
+
+/* call once at the top of every frame */
+void GLState_beginFrame(void)
+{
+  for (int i = 0; i < GL_STATE_KINDS; i++)
+  {
+    glState.total.hits[i] += glState.frame.hits[i];
+    glState.total.misses[i] += glState.frame.misses[i];
+  }
+  glState.lastFrame = glState.frame;
+  memset(&glState.frame, 0, sizeof(glState.frame));
+  glState.frames++;
+}
+
+void GLState_printStats(void)
+{
+  static const char* names[GL_STATE_KINDS] = {
+    "program", "vertex array", "buffer", "texture", "framebuffer"
+  };
+  unsigned long hits = 0, misses = 0;
+  for (int i = 0; i < GL_STATE_KINDS; i++)
+  {
+    hits += glState.lastFrame.hits[i];
+    misses += glState.lastFrame.misses[i];
+  }
+  printf("gl state: %lu frames, last frame %lu skipped / %lu issued\n",
+         glState.frames, hits, misses);
+  /* the frame in progress counts towards the totals too */
+  for (int i = 0; i < GL_STATE_KINDS; i++)
+    printf("  %-12s %8lu skipped %8lu issued\n", names[i],
+           glState.total.hits[i] + glState.frame.hits[i],
+           glState.total.misses[i] + glState.frame.misses[i]);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+bool stateChanged(enum GLStateKind kind, unsigned int* shadow, unsigned int value)
+{
+  if (*shadow == value)
+  {
+    glState.frame.hits[kind]++;
+    return false;
+  }
+  glState.frame.misses[kind]++;
+  *shadow = value;
+  return true;
+}
+
+/* NULL for targets that aren't shadowed */
+unsigned int* bufferShadow(GLenum target)
+{
+  switch (target)
+  {
+  case GL_ARRAY_BUFFER:
+    return &glState.arrayBuffer;
+  case GL_ELEMENT_ARRAY_BUFFER:
+    return &glState.elementBuffer;
+  case GL_UNIFORM_BUFFER:
+    return &glState.uniformBuffer;
+  default:
+    return NULL;
+  }
+}
+
+int textureSlot(GLenum target)
+{
+  switch (target)
+  {
+  case GL_TEXTURE_2D:
+    return 0;
+  case GL_TEXTURE_CUBE_MAP:
+    return 1;
+  case GL_TEXTURE_3D:
+    return 2;
+  case GL_TEXTURE_2D_ARRAY:
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef PIPELINE_STATE_H
+#define PIPELINE_STATE_H
+
+/**
+ * Pipeline State
+ * --------------
+ * Immutable bundles of program, vertex array, blend, depth, stencil and
+ * raster state, identified by a 64-bit hash of their contents. Applying one
+ * compares it group by group against the state applied last and only issues
+ * the GL calls for the groups set in the resulting bitmask, so switching
+ * between two pipelines that differ in blending touches blending only.
+ * Program and vertex array go through gl_state.h, which already filters
+ * them and stays right when other code binds those in between.
+ *
+ * Start from PipelineState_defaults, which matches a fresh context, and
+ * change the fields that matter. Raw GL calls to any of this state must be
+ * followed by PipelineState_invalidate.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gl_state.h"
+
+/* every field is 32 bits wide, so the groups have no padding to hash */
+struct BlendState {
+  int enabled;
+  GLenum srcColor;
+  GLenum dstColor;
+  GLenum srcAlpha;
+  GLenum dstAlpha;
+  GLenum equation;
+};
+
+struct DepthState {
+  int enabled;
+  int write;
+  GLenum func;
+};
+
+struct StencilState {
+  int enabled;
+  GLenum func;
+  int ref;
+  unsigned int readMask;
+  unsigned int writeMask;
+  GLenum fail;
+  GLenum depthFail;
+  GLenum pass;
+};
+
+struct RasterState {
+  int cull;
+  GLenum cullFace;
+  GLenum frontFace;
+  GLenum polygonMode;
+};
+
+struct PipelineStateDesc {
+  unsigned int program;         /* used when programPipeline is 0 */
+  unsigned int programPipeline; /* see ProgramPipeline_bind */
+  unsigned int vertexArray;
+  struct BlendState blend;
+  struct DepthState depth;
+  struct StencilState stencil;
+  struct RasterState raster;
+};
+
+enum PipelineStateGroup {
+  PIPELINE_STATE_BLEND = 1 << 0,
+  PIPELINE_STATE_DEPTH = 1 << 1,
+  PIPELINE_STATE_STENCIL = 1 << 2,
+  PIPELINE_STATE_RASTER = 1 << 3,
+  PIPELINE_STATE_ALL = (1 << 4) - 1
+};
+
+typedef struct PipelineState_T* PipelineState_T;
+
+struct PipelineStateDesc PipelineState_defaults(void);
+PipelineState_T PipelineState_new(const struct PipelineStateDesc* desc);
+void PipelineState_free(PipelineState_T state);
+uint64_t PipelineState_hash(PipelineState_T state);
+uint64_t PipelineState_hashFixed(const struct PipelineStateDesc* desc);
+void PipelineState_apply(PipelineState_T state);
+void PipelineState_invalidate(void);
+bool PipelineState_applied(struct PipelineStateDesc* desc);
+void PipelineState_printStats(void);
+/* utility functions */
+static uint64_t stateHashBytes(uint64_t hash, const void* data, size_t length);
+static unsigned int stateDiff(const struct PipelineStateDesc* a, const struct PipelineStateDesc* b);
+static void setCapability(GLenum capability, int enabled);
+
+struct PipelineState_T {
+  struct PipelineStateDesc desc;
+  uint64_t hash;
+};
+
+static struct {
+  struct PipelineStateDesc applied;
+  uint64_t appliedHash;
+  bool known; /* false until the first apply and after invalidate */
+  unsigned long applies;
+  unsigned long skipped; /* identical to the applied state */
+  unsigned long groups;  /* fixed-function groups that had to be sent to GL */
+} pipelineState;
+
+struct PipelineStateDesc PipelineState_defaults(void)
+{
+  struct PipelineStateDesc desc;
+  memset(&desc, 0, sizeof(desc));
+  desc.blend.srcColor = GL_ONE;
+  desc.blend.dstColor = GL_ZERO;
+  desc.blend.srcAlpha = GL_ONE;
+  desc.blend.dstAlpha = GL_ZERO;
+  desc.blend.equation = GL_FUNC_ADD;
+  desc.depth.write = 1;
+  desc.depth.func = GL_LESS;
+  desc.stencil.func = GL_ALWAYS;
+  desc.stencil.readMask = 0xFFFFFFFFu;
+  desc.stencil.writeMask = 0xFFFFFFFFu;
+  desc.stencil.fail = GL_KEEP;
+  desc.stencil.depthFail = GL_KEEP;
+  desc.stencil.pass = GL_KEEP;
+  desc.raster.cullFace = GL_BACK;
+  desc.raster.frontFace = GL_CCW;
+  desc.raster.polygonMode = GL_FILL;
+  return desc;
+}
+
+PipelineState_T PipelineState_new(const struct PipelineStateDesc* desc)
+{
+  PipelineState_T state = (PipelineState_T)malloc(sizeof(struct PipelineState_T));
+  if (state == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  state->desc = *desc;
+  state->hash = stateHashBytes(14695981039346656037ull, desc, sizeof(*desc));
+  return state;
+}
+
+void PipelineState_free(PipelineState_T state)
+{
+  free(state);
+}
+
+uint64_t PipelineState_hash(PipelineState_T state)
+{
+  return state->hash;
+}
+
+/**
+ * Hash of the blend, depth, stencil and raster groups alone. Unlike
+ * PipelineState_hash it leaves out the GL object names, so it is the same
+ * in every session.
+*/
+uint64_t PipelineState_hashFixed(const struct PipelineStateDesc* desc)
+{
+  size_t start = offsetof(struct PipelineStateDesc, blend);
+  return stateHashBytes(14695981039346656037ull, (const unsigned char*)desc + start,
+                        sizeof(*desc) - start);
+}
+
+void PipelineState_apply(PipelineState_T state)
+{
+  const struct PipelineStateDesc* desc = &state->desc;
+  pipelineState.applies++;
+  if (desc->programPipeline != 0)
+  {
+    GLState_useProgram(0);
+    GLState_bindProgramPipeline(desc->programPipeline);
+  }
+  else
+    GLState_useProgram(desc->program);
+  GLState_bindVertexArray(desc->vertexArray);
+
+  /* the hash rejects nearly every change before any field is compared */
+  if (pipelineState.known && pipelineState.appliedHash == state->hash &&
+      memcmp(&pipelineState.applied, desc, sizeof(*desc)) == 0)
+  {
+    pipelineState.skipped++;
+    return;
+  }
+  unsigned int diff = pipelineState.known ?
+                      stateDiff(&pipelineState.applied, desc) : PIPELINE_STATE_ALL;
+
+  if (diff & PIPELINE_STATE_BLEND)
+  {
+    setCapability(GL_BLEND, desc->blend.enabled);
+    glBlendFuncSeparate(desc->blend.srcColor, desc->blend.dstColor,
+                        desc->blend.srcAlpha, desc->blend.dstAlpha);
+    glBlendEquation(desc->blend.equation);
+  }
+  if (diff & PIPELINE_STATE_DEPTH)
+  {
+    setCapability(GL_DEPTH_TEST, desc->depth.enabled);
+    glDepthMask(desc->depth.write ? GL_TRUE : GL_FALSE);
+    glDepthFunc(desc->depth.func);
+  }
+  if (diff & PIPELINE_STATE_STENCIL)
+  {
+    setCapability(GL_STENCIL_TEST, desc->stencil.enabled);
+    glStencilFunc(desc->stencil.func, desc->stencil.ref, desc->stencil.readMask);
+    glStencilMask(desc->stencil.writeMask);
+    glStencilOp(desc->stencil.fail, desc->stencil.depthFail, desc->stencil.pass);
+  }
+  if (diff & PIPELINE_STATE_RASTER)
+  {
+    setCapability(GL_CULL_FACE, desc->raster.cull);
+    glCullFace(desc->raster.cullFace);
+    glFrontFace(desc->raster.frontFace);
+    glPolygonMode(GL_FRONT_AND_BACK, desc->raster.polygonMode);
+  }
+
+  for (unsigned int bits = diff; bits != 0; bits &= bits - 1)
+    pipelineState.groups++;
+  pipelineState.applied = *desc;
+  pipelineState.appliedHash = state->hash;
+  pipelineState.known = true;
+}
+
+/* after GL calls made around this layer; the next apply sends every group */
+void PipelineState_invalidate(void)
+{
+  pipelineState.known = false;
+}
+
+/* the description applied last; false before the first apply and after invalidate */
+bool PipelineState_applied(struct PipelineStateDesc* desc)
+{
+  if (!pipelineState.known)
+    return false;
+  *desc = pipelineState.applied;
+  return true;
+}
+
+void PipelineState_printStats(void)
+{
+  printf("pipeline state: %lu applies, %lu unchanged, %lu groups sent\n",
+         pipelineState.applies, pipelineState.skipped, pipelineState.groups);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+uint64_t stateHashBytes(uint64_t hash, const void* data, size_t length)
+{
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/* a bit per group whose fields differ */
+unsigned int stateDiff(const struct PipelineStateDesc* a, const struct PipelineStateDesc* b)
+{
+  unsigned int diff = 0;
+  if (memcmp(&a->blend, &b->blend, sizeof(a->blend)) != 0)
+    diff |= PIPELINE_STATE_BLEND;
+  if (memcmp(&a->depth, &b->depth, sizeof(a->depth)) != 0)
+    diff |= PIPELINE_STATE_DEPTH;
+  if (memcmp(&a->stencil, &b->stencil, sizeof(a->stencil)) != 0)
+    diff |= PIPELINE_STATE_STENCIL;
+  if (memcmp(&a->raster, &b->raster, sizeof(a->raster)) != 0)
+    diff |= PIPELINE_STATE_RASTER;
+  return diff;
+}
+
+void setCapability(GLenum capability, int enabled)
+{
+  if (enabled)
+    glEnable(capability);
+  else
+    glDisable(capability);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef PROGRAM_PIPELINE_H
+#define PROGRAM_PIPELINE_H
+
+/**
+ * Program Pipeline
+ * ----------------
+ * Stages are compiled once on their own and mixed into pipelines, so N
+ * vertex and M fragment stages cost N + M compiles and no links
+ * (GL_ARB_separate_shader_objects). Each stage is a separable program from
+ * glCreateShaderProgramv, and a pipeline object just points at one per
+ * stage. Without the extension a stage is a plain shader object, and every
+ * pipeline links its own program from them.
+ *
+ * Stages must outlive the pipelines made from them. Call GLExt_load first.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "pipeline_state.h"
+
+typedef struct ShaderStage_T* ShaderStage_T;
+typedef struct ProgramPipeline_T* ProgramPipeline_T;
+
+ShaderStage_T ShaderStage_new(GLenum type, const char* source);
+void ShaderStage_free(ShaderStage_T stage);
+ProgramPipeline_T ProgramPipeline_new(ShaderStage_T vertex, ShaderStage_T fragment);
+void ProgramPipeline_free(ProgramPipeline_T pipeline);
+void ProgramPipeline_bind(ProgramPipeline_T pipeline);
+void ProgramPipeline_describe(ProgramPipeline_T pipeline, struct PipelineStateDesc* desc);
+void ProgramPipeline_printStats(void);
+/* utility functions */
+static const char* stageName(GLenum type);
+static bool checkStageErrors(ShaderStage_T stage);
+static bool checkPipelineLink(unsigned int program);
+
+struct ShaderStage_T {
+  GLenum type;
+  unsigned int ID; /* separable program, or a shader object on the fallback */
+  bool separable;
+};
+
+struct ProgramPipeline_T {
+  unsigned int ID; /* pipeline object, or a linked program on the fallback */
+  bool separable;
+};
+
+/* compiles and links issued, to compare against one program per pair */
+static struct {
+  unsigned long compiles;
+  unsigned long links;
+} pipelineStats;
+
+ShaderStage_T ShaderStage_new(GLenum type, const char* source)
+{
+  ShaderStage_T stage = (ShaderStage_T)calloc(1, sizeof(struct ShaderStage_T));
+  if (stage == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  stage->type = type;
+  stage->separable = GLEXT_ARB_separate_shader_objects;
+  if (stage->separable)
+    stage->ID = glCreateShaderProgramv(type, 1, &source);
+  else
+  {
+    stage->ID = glCreateShader(type);
+    glShaderSource(stage->ID, 1, &source, NULL);
+    glCompileShader(stage->ID);
+  }
+  pipelineStats.compiles++;
+
+  if (!checkStageErrors(stage))
+  {
+    ShaderStage_free(stage);
+    return NULL;
+  }
+  return stage;
+}
+
+void ShaderStage_free(ShaderStage_T stage)
+{
+  if (stage->separable)
+    glDeleteProgram(stage->ID);
+  else
+    glDeleteShader(stage->ID);
+  free(stage);
+}
+
+ProgramPipeline_T ProgramPipeline_new(ShaderStage_T vertex, ShaderStage_T fragment)
+{
+  ProgramPipeline_T pipeline = (ProgramPipeline_T)calloc(1, sizeof(struct ProgramPipeline_T));
+  if (pipeline == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  pipeline->separable = vertex->separable && fragment->separable;
+
+  if (pipeline->separable)
+  {
+    glGenProgramPipelines(1, &pipeline->ID);
+    glUseProgramStages(pipeline->ID, GL_VERTEX_SHADER_BIT, vertex->ID);
+    glUseProgramStages(pipeline->ID, GL_FRAGMENT_SHADER_BIT, fragment->ID);
+    return pipeline;
+  }
+
+  pipeline->ID = glCreateProgram();
+  glAttachShader(pipeline->ID, vertex->ID);
+  glAttachShader(pipeline->ID, fragment->ID);
+  glLinkProgram(pipeline->ID);
+  pipelineStats.links++;
+  /* the stages stay alive for other pipelines */
+  glDetachShader(pipeline->ID, vertex->ID);
+  glDetachShader(pipeline->ID, fragment->ID);
+  if (!checkPipelineLink(pipeline->ID))
+  {
+    ProgramPipeline_free(pipeline);
+    return NULL;
+  }
+  return pipeline;
+}
+
+void ProgramPipeline_free(ProgramPipeline_T pipeline)
+{
+  if (pipeline->separable)
+  {
+    glDeleteProgramPipelines(1, &pipeline->ID);
+    GLState_forget(pipeline->ID);
+  }
+  else
+    glDeleteProgram(pipeline->ID);
+  free(pipeline);
+}
+
+void ProgramPipeline_bind(ProgramPipeline_T pipeline)
+{
+  if (pipeline->separable)
+  {
+    /* a program made current with glUseProgram wins over any pipeline */
+    GLState_useProgram(0);
+    GLState_bindProgramPipeline(pipeline->ID);
+  }
+  else
+    GLState_useProgram(pipeline->ID);
+}
+
+/* points a pipeline state description at this pipeline */
+void ProgramPipeline_describe(ProgramPipeline_T pipeline, struct PipelineStateDesc* desc)
+{
+  desc->program = pipeline->separable ? 0 : pipeline->ID;
+  desc->programPipeline = pipeline->separable ? pipeline->ID : 0;
+}
+
+void ProgramPipeline_printStats(void)
+{
+  printf("pipelines: %lu stage compiles, %lu links\n",
+         pipelineStats.compiles, pipelineStats.links);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+const char* stageName(GLenum type)
+{
+  return type == GL_VERTEX_SHADER ? "VERTEX" :
+         type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "GEOMETRY";
+}
+
+/* a separable stage reports its compile log through the program */
+bool checkStageErrors(ShaderStage_T stage)
+{
+  int success;
+  char infoLog[1024];
+  if (stage->separable)
+  {
+    glGetProgramiv(stage->ID, GL_LINK_STATUS, &success);
+    if (!success)
+      glGetProgramInfoLog(stage->ID, 1024, NULL, infoLog);
+  }
+  else
+  {
+    glGetShaderiv(stage->ID, GL_COMPILE_STATUS, &success);
+    if (!success)
+      glGetShaderInfoLog(stage->ID, 1024, NULL, infoLog);
+  }
+  if (!success)
+  {
+    printf("ERROR::SHADER_COMPILATION_ERROR of type: %s\n", stageName(stage->type));
+    printf("%s\n", infoLog);
+  }
+  return success != 0;
+}
+
+bool checkPipelineLink(unsigned int program)
+{
+  int success;
+  char infoLog[1024];
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    glGetProgramInfoLog(program, 1024, NULL, infoLog);
+    printf("ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\n");
+    printf("%s\n", infoLog);
+  }
+  return success != 0;
+}
+
+#endif
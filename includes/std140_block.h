@@ -0,0 +1,126 @@
+#ifndef STD140_BLOCK_H
+#define STD140_BLOCK_H
+
+/**
+ * Std140 Block
+ * ------------
+ * Declares a uniform block once and derives both sides from it: a C
+ * struct whose members sit at their std140 offsets, and the GLSL text of
+ * the block. The struct is uploaded whole with one glBufferSubData (or
+ * memcpy into a UniformSlice); no per-field writes.
+ *
+ *   #define FRAME_DATA_FIELDS(X, Block) \
+ *     X(Block, mat4, view)                \
+ *     X(Block, float, time)
+ *   STD140_BLOCK(FrameData, FRAME_DATA_FIELDS)
+ *
+ * gives struct FrameData, the string FrameData_glsl and
+ * FrameData_verify(program). Field types are float, int, vec2, vec3, vec4,
+ * mat3 and mat4; arrays are not supported. A mat3 is three columns of
+ * four floats, the last of each unused.
+ *
+ * Member alignment comes from _Alignas, and every field is checked with
+ * _Static_assert, so a compiler that lays the struct out differently
+ * fails to build instead of uploading garbage. FrameData_verify compares
+ * the offsets with what the linker reports for a real program.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* host member for each GLSL type, with its std140 base alignment */
+#define STD140_MEMBER_float(name) float name;
+#define STD140_MEMBER_int(name) int name;
+#define STD140_MEMBER_vec2(name) _Alignas(8) float name[2];
+#define STD140_MEMBER_vec3(name) _Alignas(16) float name[3];
+#define STD140_MEMBER_vec4(name) _Alignas(16) float name[4];
+#define STD140_MEMBER_mat3(name) _Alignas(16) float name[3][4];
+#define STD140_MEMBER_mat4(name) _Alignas(16) float name[4][4];
+
+#define STD140_ALIGN_float 4
+#define STD140_ALIGN_int 4
+#define STD140_ALIGN_vec2 8
+#define STD140_ALIGN_vec3 16
+#define STD140_ALIGN_vec4 16
+#define STD140_ALIGN_mat3 16
+#define STD140_ALIGN_mat4 16
+
+#define STD140_SIZE_float 4
+#define STD140_SIZE_int 4
+#define STD140_SIZE_vec2 8
+#define STD140_SIZE_vec3 12
+#define STD140_SIZE_vec4 16
+#define STD140_SIZE_mat3 48
+#define STD140_SIZE_mat4 64
+
+/* X-macro bodies, one per generated item */
+#define STD140_FIELD_MEMBER(Block, type, name) STD140_MEMBER_##type(name)
+#define STD140_FIELD_CHECK(Block, type, name)                                       \
+  _Static_assert(offsetof(struct Block, name) % STD140_ALIGN_##type == 0,           \
+                 #Block "." #name " is not std140 aligned");                        \
+  _Static_assert(sizeof(((struct Block*)0)->name) == STD140_SIZE_##type,            \
+                 #Block "." #name " does not have its std140 size");
+#define STD140_FIELD_GLSL(Block, type, name) "    " #type " " #name ";\n"
+#define STD140_FIELD_NAME(Block, type, name) #name,
+#define STD140_FIELD_OFFSET(Block, type, name) offsetof(struct Block, name),
+
+#define STD140_BLOCK(Block, FIELDS)                                                 \
+  struct Block {                                                                    \
+    FIELDS(STD140_FIELD_MEMBER, Block)                                              \
+  };                                                                                \
+  FIELDS(STD140_FIELD_CHECK, Block)                                                 \
+  _Static_assert(sizeof(struct Block) % 16 == 0,                                    \
+                 #Block " is not padded to a multiple of 16 bytes");                \
+  static const char Block##_glsl[] =                                                \
+    "layout (std140) uniform " #Block "\n{\n" FIELDS(STD140_FIELD_GLSL, Block) "};\n"; \
+  static const char* const Block##_names[] = { FIELDS(STD140_FIELD_NAME, Block) };  \
+  static const size_t Block##_offsets[] = { FIELDS(STD140_FIELD_OFFSET, Block) };   \
+  static inline bool Block##_verify(unsigned int program)                           \
+  {                                                                                 \
+    return Std140Block_verify(program, #Block, Block##_names, Block##_offsets,      \
+                              (int)(sizeof(Block##_offsets) / sizeof(size_t)),      \
+                              sizeof(struct Block));                                \
+  }
+
+bool Std140Block_verify(unsigned int program, const char* block, const char* const* names,
+                        const size_t* offsets, int count, size_t size);
+
+/**
+ * Checks the host layout against the linked program. A block the program
+ * doesn't use passes, as do members the linker dropped. Prints every
+ * mismatch.
+*/
+bool Std140Block_verify(unsigned int program, const char* block, const char* const* names,
+                        const size_t* offsets, int count, size_t size)
+{
+  bool matches = true;
+  unsigned int index = glGetUniformBlockIndex(program, block);
+  if (index == GL_INVALID_INDEX)
+    return true;
+
+  int dataSize = 0;
+  glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+  if ((size_t)dataSize > size)
+  {
+    printf("ERROR::STD140 block %s is %d bytes in GLSL, %zu in C\n", block, dataSize, size);
+    matches = false;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    unsigned int uniform = GL_INVALID_INDEX;
+    int offset = -1;
+    glGetUniformIndices(program, 1, &names[i], &uniform);
+    if (uniform == GL_INVALID_INDEX)
+      continue;
+    glGetActiveUniformsiv(program, 1, &uniform, GL_UNIFORM_OFFSET, &offset);
+    if ((size_t)offset != offsets[i])
+    {
+      printf("ERROR::STD140 %s.%s is at %d in GLSL, %zu in C\n", block, names[i], offset, offsets[i]);
+      matches = false;
+    }
+  }
+  return matches;
+}
+
+#endif
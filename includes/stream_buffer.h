@@ -0,0 +1,241 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+/**
+ * Stream Buffer
+ * -------------
+ * A buffer the CPU writes straight into, split into a region per frame in
+ * flight. StreamBuffer_alloc hands out pointers into GPU-visible memory,
+ * so vertex or uniform data is written once, in place, with no staging
+ * copy and no glBufferSubData. Each region is fenced when its frame ends
+ * and StreamBuffer_beginFrame waits on the fence before the region is
+ * written again; the driver never has to guess whether the GPU is done.
+ *
+ * With GL_ARB_buffer_storage (or GL 4.4) the buffer is mapped once,
+ * persistent and coherent, for its whole lifetime. Without it each batch
+ * of writes goes through glMapBufferRange with GL_MAP_UNSYNCHRONIZED_BIT
+ * and the fences do the syncing; StreamBuffer_flush unmaps it. Call
+ * StreamBuffer_flush after writing and before any draw reading the data
+ * either way, it costs nothing on the persistent path.
+ *
+ * Slices are addressed by byte offset into StreamBuffer_buffer. For
+ * vertices allocate with the vertex size as alignment and draw with
+ * first = offset / stride, so one vertex array setup serves every frame.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+
+typedef struct StreamBuffer_T* StreamBuffer_T;
+
+/* a range of the current frame's region; valid until the region comes round */
+struct StreamSlice {
+  size_t offset; /* bytes into the buffer */
+  size_t size;
+  unsigned char* data; /* mapped, write only */
+};
+
+StreamBuffer_T StreamBuffer_new(size_t frameSize, int frames);
+void StreamBuffer_free(StreamBuffer_T stream);
+void StreamBuffer_beginFrame(StreamBuffer_T stream);
+bool StreamBuffer_alloc(StreamBuffer_T stream, size_t size, size_t alignment,
+                        struct StreamSlice* slice);
+void StreamBuffer_flush(StreamBuffer_T stream);
+unsigned int StreamBuffer_buffer(StreamBuffer_T stream);
+bool StreamBuffer_persistent(StreamBuffer_T stream);
+void StreamBuffer_printStats(StreamBuffer_T stream);
+/* utility functions */
+static void streamWait(StreamBuffer_T stream, GLsync fence);
+static bool streamMap(StreamBuffer_T stream);
+
+struct StreamBuffer_T {
+  unsigned int buffer;
+  unsigned char* mapping; /* whole buffer when persistent, else the mapped range */
+  size_t mappedFrom;      /* buffer offset of mapping on the fallback path */
+  bool persistent;
+  GLsync* fences; /* one per region, 0 once waited on */
+  size_t frameSize;
+  int frames;
+  int frame;
+  size_t used; /* bytes handed out in the current frame */
+  unsigned long stalls; /* beginFrame calls that had to block */
+  unsigned long maps;
+};
+
+StreamBuffer_T StreamBuffer_new(size_t frameSize, int frames)
+{
+  StreamBuffer_T stream = (StreamBuffer_T)calloc(1, sizeof(struct StreamBuffer_T));
+  if (stream == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  stream->frameSize = frameSize;
+  stream->frames = frames > 0 ? frames : 1;
+  stream->frame = -1;
+  stream->fences = (GLsync*)calloc(stream->frames, sizeof(GLsync));
+  if (stream->fences == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* the copy target leaves the caller's array and uniform bindings alone */
+  GLsizeiptr size = (GLsizeiptr)(stream->frameSize * stream->frames);
+  glGenBuffers(1, &stream->buffer);
+  GLState_bindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+  if (GLEXT_ARB_buffer_storage)
+  {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+    stream->mapping = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+    stream->persistent = stream->mapping != NULL;
+    stream->maps = stream->persistent;
+    if (!stream->persistent)
+    {
+      /* immutable storage can't be respecified, start over with a new name */
+      glDeleteBuffers(1, &stream->buffer);
+      GLState_forget(stream->buffer);
+      glGenBuffers(1, &stream->buffer);
+      GLState_bindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+    }
+  }
+  if (!stream->persistent)
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+  return stream;
+}
+
+void StreamBuffer_free(StreamBuffer_T stream)
+{
+  if (stream->mapping != NULL)
+  {
+    GLState_bindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  for (int i = 0; i < stream->frames; i++)
+    if (stream->fences[i] != 0)
+      glDeleteSync(stream->fences[i]);
+  glDeleteBuffers(1, &stream->buffer);
+  GLState_forget(stream->buffer);
+  free(stream->fences);
+  free(stream);
+}
+
+/**
+ * Fences the region just finished, then moves to the next one and waits
+ * until the GPU has read everything it held. Call once per frame, after
+ * the previous frame's last draw was issued.
+*/
+void StreamBuffer_beginFrame(StreamBuffer_T stream)
+{
+  StreamBuffer_flush(stream);
+  if (stream->frame >= 0)
+    stream->fences[stream->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  stream->frame = (stream->frame + 1) % stream->frames;
+  stream->used = 0;
+  if (stream->fences[stream->frame] != 0)
+  {
+    streamWait(stream, stream->fences[stream->frame]);
+    glDeleteSync(stream->fences[stream->frame]);
+    stream->fences[stream->frame] = 0;
+  }
+}
+
+bool StreamBuffer_alloc(StreamBuffer_T stream, size_t size, size_t alignment,
+                        struct StreamSlice* slice)
+{
+  /* aligned in the buffer, not the region: frameSize needn't be a multiple */
+  size_t base = stream->frame >= 0 ? (size_t)stream->frame * stream->frameSize : 0;
+  size_t offset = alignment > 1 ? (base + stream->used + alignment - 1) / alignment * alignment - base
+                                : stream->used;
+  if (stream->frame < 0 || offset + size > stream->frameSize)
+  {
+    printf("ERROR::STREAM_BUFFER out of space (%zu of %zu bytes)\n",
+           offset + size, stream->frameSize);
+    return false;
+  }
+  if (!stream->persistent && stream->mapping == NULL)
+  {
+    /* map from the aligned start, the padding before it is never read */
+    stream->used = offset;
+    if (!streamMap(stream))
+      return false;
+  }
+  slice->offset = base + offset;
+  slice->size = size;
+  slice->data = stream->mapping + (slice->offset - stream->mappedFrom);
+  stream->used = offset + size;
+  return true;
+}
+
+/* makes every slice written so far visible to the draws that follow */
+void StreamBuffer_flush(StreamBuffer_T stream)
+{
+  if (stream->persistent || stream->mapping == NULL)
+    return;
+  size_t written = stream->frame * stream->frameSize + stream->used - stream->mappedFrom;
+  GLState_bindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+  if (written > 0)
+    glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)written);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  stream->mapping = NULL;
+}
+
+unsigned int StreamBuffer_buffer(StreamBuffer_T stream)
+{
+  return stream->buffer;
+}
+
+bool StreamBuffer_persistent(StreamBuffer_T stream)
+{
+  return stream->persistent;
+}
+
+void StreamBuffer_printStats(StreamBuffer_T stream)
+{
+  printf("stream buffer: %s, %d x %zu bytes, %lu maps, %lu stalls\n",
+         stream->persistent ? "persistent" : "unsynchronized",
+         stream->frames, stream->frameSize, stream->maps, stream->stalls);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+void streamWait(StreamBuffer_T stream, GLsync fence)
+{
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+    return;
+  stream->stalls++;
+  /* the flush bit makes sure the fence itself reaches the GPU */
+  do
+    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+  while (status == GL_TIMEOUT_EXPIRED);
+  if (status == GL_WAIT_FAILED)
+    printf("ERROR::STREAM_BUFFER fence wait failed\n");
+}
+
+/* maps the rest of the current region; the fence already made it safe */
+bool streamMap(StreamBuffer_T stream)
+{
+  size_t from = stream->frame * stream->frameSize + stream->used;
+  size_t length = (stream->frame + 1) * stream->frameSize - from;
+  GLState_bindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+  stream->mapping = (unsigned char*)glMapBufferRange(
+    GL_COPY_WRITE_BUFFER, (GLintptr)from, (GLsizeiptr)length,
+    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+    GL_MAP_FLUSH_EXPLICIT_BIT);
+  if (stream->mapping == NULL)
+  {
+    printf("ERROR::STREAM_BUFFER map failed\n");
+    return false;
+  }
+  stream->mappedFrom = from;
+  stream->maps++;
+  return true;
+}
+
+#endif
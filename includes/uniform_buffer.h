@@ -0,0 +1,194 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+/**
+ * Uniform Buffer
+ * --------------
+ * Uniform blocks streamed through a StreamBuffer (see stream_buffer.h):
+ * each frame hands out slices linearly from its fenced region, aligned to
+ * GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and the block is written straight
+ * into the mapped buffer. The caller fills every slice for the frame,
+ * makes them visible with a single UniformRing_upload, and then binds
+ * each slice with glBindBufferRange before the draw that reads it.
+ *
+ * Std140 packs values by the std140 layout rules, so a C struct never has
+ * to mirror GLSL padding by hand.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gl_state.h"
+#include "stream_buffer.h"
+
+typedef struct UniformRing_T* UniformRing_T;
+
+/* a block's place in the ring; valid until the same region comes round */
+struct UniformSlice {
+  size_t offset;
+  size_t size;
+  unsigned char* data; /* mapped buffer memory, write only */
+};
+
+/* std140 writer over a slice */
+struct Std140 {
+  unsigned char* data;
+  size_t size;
+  size_t offset;
+};
+
+UniformRing_T UniformRing_new(size_t frameSize, int frames);
+void UniformRing_free(UniformRing_T ring);
+void UniformRing_beginFrame(UniformRing_T ring);
+bool UniformRing_alloc(UniformRing_T ring, size_t size, struct UniformSlice* slice);
+void UniformRing_upload(UniformRing_T ring);
+void UniformRing_bind(UniformRing_T ring, const struct UniformSlice* slice, unsigned int binding);
+void UniformRing_printStats(UniformRing_T ring);
+
+struct Std140 Std140_begin(const struct UniformSlice* slice);
+void Std140_float(struct Std140* block, float value);
+void Std140_int(struct Std140* block, int value);
+void Std140_vec2(struct Std140* block, const float* value);
+void Std140_vec3(struct Std140* block, const float* value);
+void Std140_vec4(struct Std140* block, const float* value);
+void Std140_mat4(struct Std140* block, const float* columnMajor);
+void Std140_floatArray(struct Std140* block, const float* values, int count);
+/* utility functions */
+static size_t alignUp(size_t value, size_t alignment);
+static void writeStd140(struct Std140* block, size_t alignment, const void* value, size_t size);
+
+struct UniformRing_T {
+  StreamBuffer_T stream;
+  size_t alignment;
+};
+
+UniformRing_T UniformRing_new(size_t frameSize, int frames)
+{
+  int alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+  UniformRing_T ring = (UniformRing_T)calloc(1, sizeof(struct UniformRing_T));
+  if (ring == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  ring->alignment = (size_t)alignment;
+  ring->stream = StreamBuffer_new(alignUp(frameSize, ring->alignment), frames);
+  return ring;
+}
+
+void UniformRing_free(UniformRing_T ring)
+{
+  StreamBuffer_free(ring->stream);
+  free(ring);
+}
+
+/**
+ * Move to the next frame's region; everything from that region is
+ * dropped. Blocks if the GPU is still reading it from frames ago.
+*/
+void UniformRing_beginFrame(UniformRing_T ring)
+{
+  StreamBuffer_beginFrame(ring->stream);
+}
+
+bool UniformRing_alloc(UniformRing_T ring, size_t size, struct UniformSlice* slice)
+{
+  struct StreamSlice stream;
+  if (!StreamBuffer_alloc(ring->stream, size, ring->alignment, &stream))
+    return false;
+  slice->offset = stream.offset;
+  slice->size = stream.size;
+  slice->data = stream.data;
+  memset(slice->data, 0, size);
+  return true;
+}
+
+/* publishes every slice written since the last upload, no copy involved */
+void UniformRing_upload(UniformRing_T ring)
+{
+  StreamBuffer_flush(ring->stream);
+}
+
+void UniformRing_bind(UniformRing_T ring, const struct UniformSlice* slice, unsigned int binding)
+{
+  GLState_bindBufferRange(GL_UNIFORM_BUFFER, binding, StreamBuffer_buffer(ring->stream),
+                          (GLintptr)slice->offset, (GLsizeiptr)slice->size);
+}
+
+void UniformRing_printStats(UniformRing_T ring)
+{
+  StreamBuffer_printStats(ring->stream);
+}
+
+struct Std140 Std140_begin(const struct UniformSlice* slice)
+{
+  struct Std140 block = { slice->data, slice->size, 0 };
+  return block;
+}
+
+void Std140_float(struct Std140* block, float value)
+{
+  writeStd140(block, 4, &value, sizeof(value));
+}
+
+void Std140_int(struct Std140* block, int value)
+{
+  writeStd140(block, 4, &value, sizeof(value));
+}
+
+void Std140_vec2(struct Std140* block, const float* value)
+{
+  writeStd140(block, 8, value, 2 * sizeof(float));
+}
+
+/* a vec3 is aligned like a vec4 but only takes 12 bytes */
+void Std140_vec3(struct Std140* block, const float* value)
+{
+  writeStd140(block, 16, value, 3 * sizeof(float));
+}
+
+void Std140_vec4(struct Std140* block, const float* value)
+{
+  writeStd140(block, 16, value, 4 * sizeof(float));
+}
+
+void Std140_mat4(struct Std140* block, const float* columnMajor)
+{
+  for (int column = 0; column < 4; column++)
+    writeStd140(block, 16, columnMajor + 4 * column, 4 * sizeof(float));
+}
+
+/* every array element takes a full 16 byte slot */
+void Std140_floatArray(struct Std140* block, const float* values, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    writeStd140(block, 16, &values[i], sizeof(float));
+    block->offset = alignUp(block->offset, 16);
+  }
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+size_t alignUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void writeStd140(struct Std140* block, size_t alignment, const void* value, size_t size)
+{
+  size_t offset = alignUp(block->offset, alignment);
+  if (offset + size > block->size)
+  {
+    printf("ERROR::STD140 block overflow at byte %zu\n", offset);
+    return;
+  }
+  memcpy(block->data + offset, value, size);
+  block->offset = offset + size;
+}
+
+#endif
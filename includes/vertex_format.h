@@ -0,0 +1,365 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+/**
+ * Vertex Format
+ * -------------
+ * Compiles a high-precision vertex layout, every attribute a run of
+ * floats, into a packed one and converts vertex data to it:
+ *
+ *   VERTEX_ENCODING_HALF        16-bit floats, no decode needed
+ *   VERTEX_ENCODING_SNORM16     16-bit, normalized against the bounding box
+ *                               of the data; the shader computes
+ *                               value * scale + offset (VertexFormat_decode)
+ *   VERTEX_ENCODING_UNORM8      8-bit, for [0, 1] data such as colors
+ *   VERTEX_ENCODING_OCTAHEDRAL  a unit vec3 folded onto two snorm16; the
+ *                               shader unfolds it with octahedralDecode from
+ *                               VertexFormat_octahedralGlsl
+ *
+ * A position plus color drops from 24 bytes to 12 this way. The compiled
+ * attributes are what glVertexAttribPointer needs: VertexFormat_setup
+ * issues the calls, or hand them and the stride to GeometryArena_new.
+ * Every attribute starts 4-byte aligned.
+ *
+ * Normalized shorts are decoded as (2c + 1) / 65535 before GL 4.2, which
+ * can't hit 0 exactly; the error is below half a step either way.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define VERTEX_FORMAT_MAX_ATTRIBUTES 16
+
+/* one glVertexAttribPointer call of the format */
+struct VertexAttribute {
+  unsigned int location;
+  int size;        /* components */
+  GLenum type;
+  bool normalized;
+  unsigned int offset; /* bytes into the vertex */
+};
+
+enum VertexEncoding {
+  VERTEX_ENCODING_FLOAT,
+  VERTEX_ENCODING_HALF,
+  VERTEX_ENCODING_SNORM16,
+  VERTEX_ENCODING_UNORM8,
+  VERTEX_ENCODING_OCTAHEDRAL
+};
+
+/* an attribute of the input: components floats, in declaration order */
+struct VertexInput {
+  unsigned int location;
+  int components; /* 1 to 4; 3 for octahedral */
+  enum VertexEncoding encoding;
+};
+
+struct VertexFormat {
+  struct VertexAttribute attributes[VERTEX_FORMAT_MAX_ATTRIBUTES];
+  struct VertexInput inputs[VERTEX_FORMAT_MAX_ATTRIBUTES];
+  unsigned int inputOffsets[VERTEX_FORMAT_MAX_ATTRIBUTES]; /* floats into an input vertex */
+  float boundsMin[VERTEX_FORMAT_MAX_ATTRIBUTES][4]; /* snorm16 only */
+  float boundsMax[VERTEX_FORMAT_MAX_ATTRIBUTES][4];
+  bool fitted;
+  int count;
+  unsigned int inputStride; /* bytes */
+  unsigned int stride;      /* bytes of a packed vertex */
+};
+
+static const char VertexFormat_octahedralGlsl[] =
+  "vec3 octahedralDecode(vec2 e)\n"
+  "{\n"
+  "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+  "    float t = max(-n.z, 0.0);\n"
+  "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"
+  "    return normalize(n);\n"
+  "}\n";
+
+bool VertexFormat_compile(const struct VertexInput* inputs, int count, struct VertexFormat* format);
+void VertexFormat_fit(struct VertexFormat* format, const float* vertices, unsigned int vertexCount);
+void VertexFormat_encode(struct VertexFormat* format, const float* vertices,
+                         unsigned int vertexCount, void* packed);
+size_t VertexFormat_size(const struct VertexFormat* format, unsigned int vertexCount);
+bool VertexFormat_decode(const struct VertexFormat* format, unsigned int location,
+                         float scale[4], float offset[4]);
+void VertexFormat_setup(const struct VertexAttribute* attributes, int count, unsigned int stride);
+/* utility functions */
+static uint16_t floatToHalf(float value);
+static int16_t toSnorm16(float value);
+static float clampFloat(float value, float low, float high);
+static void octahedralEncode(const float* normal, float* encoded);
+
+/**
+ * Lays out the packed vertex for inputs. Returns false for a layout it
+ * can't pack: too many attributes, a component count out of range, or an
+ * octahedral attribute that isn't a vec3.
+*/
+bool VertexFormat_compile(const struct VertexInput* inputs, int count, struct VertexFormat* format)
+{
+  memset(format, 0, sizeof(*format));
+  if (count > VERTEX_FORMAT_MAX_ATTRIBUTES)
+  {
+    printf("ERROR::VERTEX_FORMAT %d attributes, at most %d\n", count, VERTEX_FORMAT_MAX_ATTRIBUTES);
+    return false;
+  }
+  unsigned int offset = 0, inputOffset = 0;
+  for (int i = 0; i < count; i++)
+  {
+    const struct VertexInput* input = &inputs[i];
+    struct VertexAttribute* attribute = &format->attributes[i];
+    if (input->components < 1 || input->components > 4 ||
+        (input->encoding == VERTEX_ENCODING_OCTAHEDRAL && input->components != 3))
+    {
+      printf("ERROR::VERTEX_FORMAT location %u can't encode %d components\n",
+             input->location, input->components);
+      return false;
+    }
+    attribute->location = input->location;
+    attribute->size = input->components;
+    attribute->offset = offset;
+    unsigned int bytes = 0;
+    switch (input->encoding)
+    {
+    case VERTEX_ENCODING_FLOAT:
+      attribute->type = GL_FLOAT;
+      bytes = 4 * input->components;
+      break;
+    case VERTEX_ENCODING_HALF:
+      attribute->type = GL_HALF_FLOAT;
+      bytes = 2 * input->components;
+      break;
+    case VERTEX_ENCODING_SNORM16:
+      attribute->type = GL_SHORT;
+      attribute->normalized = true;
+      bytes = 2 * input->components;
+      break;
+    case VERTEX_ENCODING_UNORM8:
+      attribute->type = GL_UNSIGNED_BYTE;
+      attribute->normalized = true;
+      bytes = input->components;
+      break;
+    case VERTEX_ENCODING_OCTAHEDRAL:
+      attribute->type = GL_SHORT;
+      attribute->normalized = true;
+      attribute->size = 2;
+      bytes = 4;
+      break;
+    }
+    format->inputs[i] = *input;
+    format->inputOffsets[i] = inputOffset;
+    inputOffset += input->components;
+    offset += (bytes + 3) & ~3u;
+  }
+  format->count = count;
+  format->inputStride = inputOffset * sizeof(float);
+  format->stride = offset;
+  return true;
+}
+
+/* grows the snorm16 bounding boxes to take in vertices */
+void VertexFormat_fit(struct VertexFormat* format, const float* vertices, unsigned int vertexCount)
+{
+  unsigned int floats = format->inputStride / sizeof(float);
+  for (int i = 0; i < format->count; i++)
+  {
+    if (format->inputs[i].encoding != VERTEX_ENCODING_SNORM16)
+      continue;
+    for (unsigned int v = 0; v < vertexCount; v++)
+      for (int c = 0; c < format->inputs[i].components; c++)
+      {
+        float value = vertices[v * floats + format->inputOffsets[i] + c];
+        if (!format->fitted && v == 0)
+          format->boundsMin[i][c] = format->boundsMax[i][c] = value;
+        if (value < format->boundsMin[i][c])
+          format->boundsMin[i][c] = value;
+        if (value > format->boundsMax[i][c])
+          format->boundsMax[i][c] = value;
+      }
+  }
+  format->fitted = format->fitted || vertexCount > 0;
+}
+
+/**
+ * Packs vertexCount input vertices into packed, VertexFormat_size bytes.
+ * The first encode fits the bounding boxes to its data unless
+ * VertexFormat_fit ran before; later ones reuse them, so every mesh of a
+ * format shares one decode. snorm16 values outside the box are clamped.
+*/
+void VertexFormat_encode(struct VertexFormat* format, const float* vertices,
+                         unsigned int vertexCount, void* packed)
+{
+  if (!format->fitted)
+    VertexFormat_fit(format, vertices, vertexCount);
+  unsigned int floats = format->inputStride / sizeof(float);
+  unsigned char* out = (unsigned char*)packed;
+  memset(out, 0, VertexFormat_size(format, vertexCount));
+  for (unsigned int v = 0; v < vertexCount; v++)
+  {
+    const float* vertex = vertices + v * floats;
+    unsigned char* target = out + v * format->stride;
+    for (int i = 0; i < format->count; i++)
+    {
+      const float* value = vertex + format->inputOffsets[i];
+      unsigned char* slot = target + format->attributes[i].offset;
+      int components = format->inputs[i].components;
+      switch (format->inputs[i].encoding)
+      {
+      case VERTEX_ENCODING_FLOAT:
+        memcpy(slot, value, components * sizeof(float));
+        break;
+      case VERTEX_ENCODING_HALF:
+        for (int c = 0; c < components; c++)
+        {
+          uint16_t half = floatToHalf(value[c]);
+          memcpy(slot + 2 * c, &half, sizeof(half));
+        }
+        break;
+      case VERTEX_ENCODING_SNORM16:
+        for (int c = 0; c < components; c++)
+        {
+          float extent = 0.5f * (format->boundsMax[i][c] - format->boundsMin[i][c]);
+          float center = 0.5f * (format->boundsMax[i][c] + format->boundsMin[i][c]);
+          int16_t snorm = toSnorm16(extent > 0.0f ? (value[c] - center) / extent : 0.0f);
+          memcpy(slot + 2 * c, &snorm, sizeof(snorm));
+        }
+        break;
+      case VERTEX_ENCODING_UNORM8:
+        for (int c = 0; c < components; c++)
+        {
+          slot[c] = (unsigned char)(clampFloat(value[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        break;
+      case VERTEX_ENCODING_OCTAHEDRAL:
+      {
+        float encoded[2];
+        octahedralEncode(value, encoded);
+        int16_t snorm[2] = { toSnorm16(encoded[0]), toSnorm16(encoded[1]) };
+        memcpy(slot, snorm, sizeof(snorm));
+        break;
+      }
+      }
+    }
+  }
+}
+
+size_t VertexFormat_size(const struct VertexFormat* format, unsigned int vertexCount)
+{
+  return (size_t)format->stride * vertexCount;
+}
+
+/**
+ * The uniform values that turn what the shader reads for location back
+ * into the input: input = value * scale + offset. Identity, and false,
+ * for attributes that need no decode.
+*/
+bool VertexFormat_decode(const struct VertexFormat* format, unsigned int location,
+                         float scale[4], float offset[4])
+{
+  for (int c = 0; c < 4; c++)
+  {
+    scale[c] = 1.0f;
+    offset[c] = 0.0f;
+  }
+  for (int i = 0; i < format->count; i++)
+  {
+    if (format->inputs[i].location != location ||
+        format->inputs[i].encoding != VERTEX_ENCODING_SNORM16)
+      continue;
+    for (int c = 0; c < format->inputs[i].components; c++)
+    {
+      scale[c] = 0.5f * (format->boundsMax[i][c] - format->boundsMin[i][c]);
+      offset[c] = 0.5f * (format->boundsMax[i][c] + format->boundsMin[i][c]);
+    }
+    return true;
+  }
+  return false;
+}
+
+/* points the bound vertex array at the bound GL_ARRAY_BUFFER */
+void VertexFormat_setup(const struct VertexAttribute* attributes, int count, unsigned int stride)
+{
+  for (int i = 0; i < count; i++)
+  {
+    const struct VertexAttribute* attribute = &attributes[i];
+    glVertexAttribPointer(attribute->location, attribute->size, attribute->type,
+                          attribute->normalized ? GL_TRUE : GL_FALSE,
+                          (GLsizei)stride, (const void*)(size_t)attribute->offset);
+    glEnableVertexAttribArray(attribute->location);
+  }
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* IEEE binary16, rounded to nearest even */
+uint16_t floatToHalf(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  if (exponent == 0xFF)
+    return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+  int halfExponent = (int)exponent - 127 + 15;
+  if (halfExponent >= 31)
+    return sign | 0x7C00;
+  if (halfExponent <= 0)
+  {
+    if (halfExponent < -10)
+      return sign;
+    /* subnormal: shift the mantissa, implicit bit included */
+    mantissa |= 0x800000;
+    int shift = 14 - halfExponent;
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return sign | (uint16_t)half;
+  }
+  uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1FFF;
+  /* a carry out of the mantissa bumps the exponent, up to infinity */
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return sign | (uint16_t)half;
+}
+
+int16_t toSnorm16(float value)
+{
+  float scaled = clampFloat(value, -1.0f, 1.0f) * 32767.0f;
+  return (int16_t)(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+}
+
+float clampFloat(float value, float low, float high)
+{
+  return value < low ? low : (value > high ? high : value);
+}
+
+/* the unit vector projected onto an octahedron, lower half folded over */
+void octahedralEncode(const float* normal, float* encoded)
+{
+  float sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+  if (sum == 0.0f)
+  {
+    encoded[0] = encoded[1] = 0.0f;
+    return;
+  }
+  float x = normal[0] / sum, y = normal[1] / sum;
+  if (normal[2] < 0.0f)
+  {
+    float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+  encoded[0] = x;
+  encoded[1] = y;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef EXPLICIT_UNIFORMS_H
+#define EXPLICIT_UNIFORMS_H
+
+/**
+ * Explicit Uniforms
+ * -----------------
+ * Pins plain uniforms to the locations in the generated uniform_locations.h
+ * (see cmake/uniform_locations.cmake). Every compiled stage gets
+ * `layout(location = N)` in front of each listed declaration, so the
+ * linker can't move them: a uniform has the same location in every
+ * program, relink and hot reload, which ExplicitUniforms_verify checks
+ * against the table. The table is part of the program cache key.
+ *
+ *   static const struct ExplicitUniform table[] = {
+ *     UNIFORM_LOCATIONS(EXPLICIT_UNIFORM_ENTRY)
+ *   };
+ *   ExplicitUniforms_use(table, UNIFORM_LOCATION_COUNT);
+ *
+ * Needs GL_ARB_explicit_uniform_location or GL 4.3; without it sources are
+ * left alone and ExplicitUniforms_active is false. Uniforms are still set
+ * through Shader_set*, which keeps its value shadow and specialization
+ * working; nothing here calls glUniform* with the constants.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gl_ext.h"
+#include "shader_source.h"
+
+/* X-macro body for UNIFORM_LOCATIONS */
+#define EXPLICIT_UNIFORM_ENTRY(name, location, slots) { #name, location, slots },
+
+struct ExplicitUniform {
+  const char* name;
+  int location;
+  int slots; /* array length, each element takes a location */
+};
+
+void ExplicitUniforms_use(const struct ExplicitUniform* table, int count);
+bool ExplicitUniforms_active(void);
+uint64_t ExplicitUniforms_key(uint64_t key);
+bool ExplicitUniforms_apply(const struct ShaderSource* source, struct ShaderSource* located);
+bool ExplicitUniforms_verify(unsigned int program);
+bool ExplicitUniforms_contains(const char* name);
+/* utility functions */
+static int explicitLocation(const char* name, size_t length);
+static bool isExplicitNameChar(char c);
+static bool explicitDeclaration(const char* code, size_t length, size_t start,
+                                size_t* name, size_t* nameLength);
+
+static struct {
+  const struct ExplicitUniform* table;
+  int count;
+} explicitUniforms;
+
+/* the table must outlive every shader built after this call */
+void ExplicitUniforms_use(const struct ExplicitUniform* table, int count)
+{
+  explicitUniforms.table = table;
+  explicitUniforms.count = count;
+}
+
+bool ExplicitUniforms_active(void)
+{
+  return explicitUniforms.count > 0 && GLEXT_ARB_explicit_uniform_location;
+}
+
+/* folds the table into a program cache key; the compiled text depends on it */
+uint64_t ExplicitUniforms_key(uint64_t key)
+{
+  if (!ExplicitUniforms_active())
+    return key;
+  for (int i = 0; i < explicitUniforms.count; i++)
+  {
+    const struct ExplicitUniform* uniform = &explicitUniforms.table[i];
+    int numbers[2] = { uniform->location, uniform->slots };
+    const unsigned char* bytes = (const unsigned char*)uniform->name;
+    for (size_t j = 0; j <= strlen(uniform->name); j++)
+      key = (key ^ bytes[j]) * 1099511628211ull;
+    bytes = (const unsigned char*)numbers;
+    for (size_t j = 0; j < sizeof(numbers); j++)
+      key = (key ^ bytes[j]) * 1099511628211ull;
+  }
+  return key;
+}
+
+/**
+ * Writes source with the locations injected to located (heap storage,
+ * release it with ShaderSource_release). Declarations are rewritten in
+ * place and a pre-4.30 #version gets the extension directive plus a
+ * #line, so driver error lines still match the file. Returns false,
+ * leaving located untouched, when nothing in source is in the table.
+*/
+bool ExplicitUniforms_apply(const struct ShaderSource* source, struct ShaderSource* located)
+{
+  if (!ExplicitUniforms_active() || source->storage == SHADER_SOURCE_NONE)
+    return false;
+  const char* code = source->code;
+  size_t length = (size_t)source->length;
+
+  /* count first so the copy is allocated once */
+  int found = 0;
+  for (size_t start = 0; start < length; start++)
+  {
+    size_t name, nameLength;
+    if (explicitDeclaration(code, length, start, &name, &nameLength) &&
+        explicitLocation(code + name, nameLength) != -1)
+      found++;
+    const char* end = (const char*)memchr(code + start, '\n', length - start);
+    start = end ? (size_t)(end - code) : length;
+  }
+  if (found == 0)
+    return false;
+
+  /* #version has to stay the first statement */
+  size_t split = 0;
+  int version = 0;
+  size_t first = ShaderSource_skipBlankAndComments(code, length, 0);
+  if (length - first >= 8 && strncmp(code + first, "#version", 8) == 0)
+  {
+    const char* end = (const char*)memchr(code + first, '\n', length - first);
+    split = end ? (size_t)(end - code) + 1 : length;
+    version = atoi(code + first + 8);
+  }
+
+  char* out = (char*)malloc(length + 96 + (size_t)found * 32);
+  if (out == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t used = split;
+  memcpy(out, code, split);
+  if (version < 430)
+  {
+    if (split > 0 && out[split - 1] != '\n')
+      out[used++] = '\n';
+    int line = 1;
+    for (size_t i = 0; i < split; i++)
+      line += code[i] == '\n';
+    used += sprintf(out + used, "#extension GL_ARB_explicit_uniform_location : require\n"
+                                "#line %d 0\n", line);
+  }
+  for (size_t start = split; start < length;)
+  {
+    const char* end = (const char*)memchr(code + start, '\n', length - start);
+    size_t next = end ? (size_t)(end - code) + 1 : length;
+    size_t name, nameLength;
+    int location = -1;
+    if (explicitDeclaration(code, length, start, &name, &nameLength))
+      location = explicitLocation(code + name, nameLength);
+    if (location != -1)
+    {
+      /* indentation, the layout qualifier, then the declaration as written */
+      size_t keyword = start;
+      while (code[keyword] == ' ' || code[keyword] == '\t')
+        keyword++;
+      memcpy(out + used, code + start, keyword - start);
+      used += keyword - start;
+      used += sprintf(out + used, "layout(location = %d) ", location);
+      start = keyword;
+    }
+    memcpy(out + used, code + start, next - start);
+    used += next - start;
+    start = next;
+  }
+
+  located->code = out;
+  located->length = (GLint)used;
+  located->storage = SHADER_SOURCE_HEAP;
+  return true;
+}
+
+/* true if every listed uniform the program uses sits at its constant */
+bool ExplicitUniforms_verify(unsigned int program)
+{
+  bool matches = true;
+  if (!ExplicitUniforms_active())
+    return true;
+  for (int i = 0; i < explicitUniforms.count; i++)
+  {
+    const struct ExplicitUniform* uniform = &explicitUniforms.table[i];
+    int location = glGetUniformLocation(program, uniform->name);
+    if (location != -1 && location != uniform->location)
+    {
+      printf("ERROR::UNIFORM %s is at location %d, expected %d\n",
+             uniform->name, location, uniform->location);
+      matches = false;
+    }
+  }
+  return matches;
+}
+
+/* whether name is in the table, whether or not the extension is there */
+bool ExplicitUniforms_contains(const char* name)
+{
+  return explicitLocation(name, strlen(name)) != -1;
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+int explicitLocation(const char* name, size_t length)
+{
+  for (int i = 0; i < explicitUniforms.count; i++)
+  {
+    const char* candidate = explicitUniforms.table[i].name;
+    if (strlen(candidate) == length && strncmp(candidate, name, length) == 0)
+      return explicitUniforms.table[i].location;
+  }
+  return -1;
+}
+
+bool isExplicitNameChar(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/**
+ * Whether the line at start is `uniform <type> <name>[N];`, the same shape
+ * the generator accepts. Sets [name, name + nameLength) to the name.
+*/
+bool explicitDeclaration(const char* code, size_t length, size_t start,
+                         size_t* name, size_t* nameLength)
+{
+  size_t i = start;
+  size_t words[3], wordLengths[3];
+  int wordCount = 0;
+  while (i < length && code[i] != '\n' && code[i] != ';')
+  {
+    if (code[i] == ' ' || code[i] == '\t')
+      i++;
+    else if (isExplicitNameChar(code[i]) && wordCount < 3)
+    {
+      words[wordCount] = i;
+      while (i < length && isExplicitNameChar(code[i]))
+        i++;
+      wordLengths[wordCount] = i - words[wordCount];
+      wordCount++;
+    }
+    else if (code[i] == '[' && wordCount == 3)
+    {
+      while (i < length && code[i] != ']' && code[i] != '\n')
+        i++;
+      if (i < length && code[i] == ']')
+        i++;
+    }
+    else
+      return false;
+  }
+  if (i == length || code[i] != ';' || wordCount != 3 ||
+      wordLengths[0] != 7 || strncmp(code + words[0], "uniform", 7) != 0)
+    return false;
+  *name = words[2];
+  *nameLength = wordLengths[2];
+  return true;
+}
+
+#endif
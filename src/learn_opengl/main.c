@@ -2,14 +2,47 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
+#include "explicit_uniforms.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "std140_block.h"
+#include "material.h"
 #include "shader.h"
+#include "shader_prewarm.h"
+#include "shader_variants.h"
+#include "uniform_buffer.h"
+#include "vertex_format.h"
+/* generated from the shaders by cmake/uniform_locations.cmake */
+#include "uniform_locations.h"
+#ifdef EMBED_SHADERS
+#include "embedded_shaders.h"
+#endif
 
 /* Global Data */
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+/* where the shader files are read and watched; CMake points it at src/ */
+#ifndef SHADER_DIR
+#define SHADER_DIR "./"
+#endif
+/* uniform buffer binding points */
+const unsigned int FRAME_DATA_BINDING = 0;
+
+/* shared by every program; shaders get it with #include "frame_data.glsl" */
+#define FRAME_DATA_FIELDS(X, Block) \
+	X(Block, mat4, view)              \
+	X(Block, mat4, projection)        \
+	X(Block, float, time)
+STD140_BLOCK(FrameData, FRAME_DATA_FIELDS)
+
+/* every plain uniform pinned to its UNIFORM_LOCATION_* constant */
+static const struct ExplicitUniform explicitUniformTable[] = {
+	UNIFORM_LOCATIONS(EXPLICIT_UNIFORM_ENTRY)
+};
 
 /* Pototypes */
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -39,11 +72,76 @@ int main() {
 		printf("Failed to initialize GLAD\n");
 		return -1;
 	}
+	GLExt_load((GLADloadfunc)glfwGetProcAddress);
+	ProgramCache_open("./shader_cache");
+	/* per-program build times, appended on every run */
+	ShaderTiming_open("./shader_timing.jsonl");
+	/* what the last session drew, replayed once the shaders exist */
+	ShaderPrewarm_open("./shader_prewarm.txt");
+	ShaderInclude_define("frame_data.glsl", FrameData_glsl);
+	ExplicitUniforms_use(explicitUniformTable, UNIFORM_LOCATION_COUNT);
+	/* strip dead code from sources before the driver parses them */
+	ShaderOptimize_configure(true, false);
   
 	/* Build and compile shader program  */
 	/* --------------------------------- */
 	/* Compile vertex shader source code */
-	Shader_T ourShader = Shader_new("./shader.vert", "./shader.frag");
+#ifdef EMBED_SHADERS
+	/* compiled into the executable, nothing to find on disk */
+	Shader_T ourShader = Shader_newFromMemory((const char*)shader_vert, shader_vert_length,
+	                                          (const char*)shader_frag, shader_frag_length);
+#else
+	Shader_T ourShader = Shader_new(SHADER_DIR "shader.vert", SHADER_DIR "shader.frag");
+	/* pick up edits to the shader files without restarting */
+	Shader_watch(ourShader);
+	/* after a second, compile uniforms that never changed in as constants */
+	Shader_specialize(ourShader, 60);
+#endif
+	FrameData_verify(ourShader->ID);
+	ExplicitUniforms_verify(ourShader->ID);
+	Shader_bindUniformBlock(ourShader, "FrameData", FRAME_DATA_BINDING);
+	Shader_T drawable[2] = { ourShader };
+	int drawableCount = 1;
+	Material_T ourMaterial = Material_new(ourShader);
+	Material_setFloat(ourMaterial, "brightness", 1.0f);
+	Material_setFloat(ourMaterial, "exposure", 1.0f);
+	/* the same files built with GRAYSCALE defined, drawn while G is held */
+	ShaderVariants_T variants = NULL;
+	Material_T grayMaterial = ourMaterial;
+#ifndef EMBED_SHADERS
+	const char* features[] = { "GRAYSCALE" };
+	const uint32_t grayscale = 1u << 0;
+	variants = ShaderVariants_new(SHADER_DIR "shader.vert", SHADER_DIR "shader.frag", features, 1, 1);
+	if (variants != NULL && ShaderVariants_prewarm(variants, &grayscale, 1))
+	{
+		/* one live variant and one mask, so the program is never evicted */
+		Shader_T grayShader = ShaderVariants_get(variants, grayscale);
+		Shader_bindUniformBlock(grayShader, "FrameData", FRAME_DATA_BINDING);
+		grayMaterial = Material_new(grayShader);
+		Material_setFloat(grayMaterial, "brightness", 1.0f);
+		Material_setFloat(grayMaterial, "exposure", 1.0f);
+		drawable[drawableCount++] = grayShader;
+	}
+#endif
+	/* every program that can be drawn exists now */
+	ShaderPrewarm_replay(drawable, drawableCount);
+	/* fixed-function state for the scene; the queue binds programs and arrays */
+	struct PipelineStateDesc sceneDesc = PipelineState_defaults();
+	PipelineState_T sceneState = PipelineState_new(&sceneDesc);
+	/* draws are queued and submitted sorted by program and material */
+	RenderQueue_T renderQueue = RenderQueue_new();
+
+	/* per-frame uniform data, triple buffered and fenced */
+	UniformRing_T uniformRing = UniformRing_new(16 * 1024, 3);
+	const float identity[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+	struct FrameData frameBlock = { 0 };
+	memcpy(frameBlock.view, identity, sizeof(identity));
+	memcpy(frameBlock.projection, identity, sizeof(identity));
 
 	/* set up vertex data (and buffer(s)) and configure vertex attributes */
 	/* ------------------------------------------------------------------ */
@@ -54,23 +152,28 @@ int main() {
 		 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  // top blue   
 	};
 	
+	/* packed to half-float positions and unorm8 colors, 12 bytes a vertex */
+	const struct VertexInput inputs[] = {
+		{ 0, 3, VERTEX_ENCODING_HALF },   /* position */
+		{ 1, 3, VERTEX_ENCODING_UNORM8 }, /* color */
+	};
+	struct VertexFormat format;
+	VertexFormat_compile(inputs, 2, &format);
+	unsigned char packed[sizeof(vertices)]; /* never larger than the input */
+	VertexFormat_encode(&format, vertices, 3, packed);
+
 	unsigned int VBO, VAO;
   glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	
-	glBindVertexArray(VAO);
+	GLState_bindVertexArray(VAO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-  /* position attribute */
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	/* color attribute */
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, VertexFormat_size(&format, 3), packed, GL_STATIC_DRAW);
+	VertexFormat_setup(format.attributes, format.count, format.stride);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState_bindVertexArray(0);
 
 	// uncomment this call to draw in wireframe polygons
 	// glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -78,17 +181,33 @@ int main() {
 	// render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		GLState_beginFrame();
 		// input
 		processInput(window);
+		Shader_pollReloads();
 		
 		/* rendering commands go here */
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		/* shared data goes up once, whatever the number of programs */
+		struct UniformSlice frameData;
+		UniformRing_beginFrame(uniformRing);
+		if (UniformRing_alloc(uniformRing, sizeof(struct FrameData), &frameData))
+		{
+			/* laid out as std140 already, so the block is copied whole */
+			frameBlock.time = (float)glfwGetTime();
+			memcpy(frameData.data, &frameBlock, sizeof(frameBlock));
+			UniformRing_upload(uniformRing);
+			UniformRing_bind(uniformRing, &frameData, FRAME_DATA_BINDING);
+		}
+
     // glUseProgram(shaderProgram);
-		Shader_use(ourShader);
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		Material_T material = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS ? grayMaterial : ourMaterial;
+		RenderQueue_drawArrays(renderQueue, material, VAO, GL_TRIANGLES, 0, 3);
+		PipelineState_apply(sceneState);
+		RenderQueue_flush(renderQueue);
+		Shader_pollSpecializations();
 
 		// check and call events and swap the buffers
 		glfwSwapBuffers(window);
@@ -98,7 +217,23 @@ int main() {
 	/* de-allocate all resources, we don't need them anymore */
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	RenderQueue_free(renderQueue);
+	PipelineState_free(sceneState);
+	if (grayMaterial != ourMaterial)
+		Material_free(grayMaterial);
+	Material_free(ourMaterial);
+	if (variants != NULL)
+		ShaderVariants_free(variants);
 	Shader_free(ourShader);
+	UniformRing_printStats(uniformRing);
+	UniformRing_free(uniformRing);
+	ProgramCache_printStats();
+	ShaderOptimize_printReport();
+	ShaderRegistry_printStats();
+	Material_printStats();
+	ShaderTiming_printReport();
+	ShaderPrewarm_close();
+	GLState_printStats();
 	
 	glfwTerminate();
   return 0;
@@ -0,0 +1,280 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+/**
+ * Material
+ * --------
+ * A material is a program plus a list of uniform values. Draws are
+ * queued with their material and submitted sorted by program, then by
+ * material, so each program is bound once per flush. Binding a material
+ * pushes each of its values through the program's uniform shadow, which
+ * issues one glUniform* call per value that differs from what the program
+ * holds. A value changed in between by a direct Shader_set* call is
+ * therefore put back on the next bind, and a material bound again with
+ * nothing changed costs a compare per value and no GL calls.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "shader_prewarm.h"
+
+typedef struct Material_T* Material_T;
+typedef struct RenderQueue_T* RenderQueue_T;
+
+Material_T Material_new(Shader_T shader);
+void Material_free(Material_T material);
+void Material_setInt(Material_T material, const char* name, int value);
+void Material_setFloat(Material_T material, const char* name, float value);
+void Material_bind(Material_T material);
+void Material_printStats(void);
+RenderQueue_T RenderQueue_new(void);
+void RenderQueue_free(RenderQueue_T queue);
+void RenderQueue_drawArrays(RenderQueue_T queue, Material_T material, unsigned int vertexArray,
+                            GLenum mode, int first, int count);
+void RenderQueue_drawElements(RenderQueue_T queue, Material_T material, unsigned int vertexArray,
+                              GLenum mode, int count, GLenum type, size_t offset);
+void RenderQueue_flush(RenderQueue_T queue);
+/* utility functions */
+static struct MaterialParam* materialParam(Material_T material, const char* name, GLenum type);
+static struct QueuedDraw* queueDraw(RenderQueue_T queue, Material_T material, unsigned int vertexArray);
+static int compareDraws(const void* a, const void* b);
+
+struct MaterialParam {
+  char* name;
+  ShaderUniform uniform;
+  GLenum type; /* GL_INT or GL_FLOAT */
+  union {
+    int i;
+    float f;
+  } value;
+};
+
+struct Material_T {
+  Shader_T shader;
+  unsigned int id; /* creation order, the second sort key */
+  struct MaterialParam* params;
+  int paramCount;
+};
+
+struct QueuedDraw {
+  uint64_t key; /* program << 32 | material */
+  int order;    /* submission order, keeps the sort stable */
+  Material_T material;
+  unsigned int vertexArray;
+  GLenum mode;
+  bool indexed;
+  int first;
+  int count;
+  GLenum type;
+  size_t offset;
+};
+
+struct RenderQueue_T {
+  struct QueuedDraw* draws;
+  int count;
+  int capacity;
+};
+
+static struct {
+  Material_T current;
+  unsigned int nextId;
+  unsigned long draws;
+  unsigned long programSwitches;
+  unsigned long materialSwitches;
+  unsigned long paramChecks; /* uploads are in Shader_printUniformStats */
+} materialState;
+
+Material_T Material_new(Shader_T shader)
+{
+  Material_T material = (Material_T)calloc(1, sizeof(struct Material_T));
+  if (material == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  material->shader = shader;
+  material->id = materialState.nextId++;
+  return material;
+}
+
+void Material_free(Material_T material)
+{
+  if (materialState.current == material)
+    materialState.current = NULL;
+  for (int i = 0; i < material->paramCount; i++)
+    free(material->params[i].name);
+  free(material->params);
+  free(material);
+}
+
+void Material_setInt(Material_T material, const char* name, int value)
+{
+  materialParam(material, name, GL_INT)->value.i = value;
+}
+
+void Material_setFloat(Material_T material, const char* name, float value)
+{
+  materialParam(material, name, GL_FLOAT)->value.f = value;
+}
+
+/* binds the program if needed and uploads the values the program lacks */
+void Material_bind(Material_T material)
+{
+  Shader_T shader = material->shader;
+  if (GLState_program() != shader->ID)
+  {
+    Shader_use(shader);
+    materialState.programSwitches++;
+  }
+  /* every time: a Shader_set* since the last bind may have changed one */
+  for (int i = 0; i < material->paramCount; i++)
+  {
+    const struct MaterialParam* param = &material->params[i];
+    if (param->type == GL_INT)
+      Shader_setIntAt(shader, param->uniform, param->value.i);
+    else
+      Shader_setFloatAt(shader, param->uniform, param->value.f);
+  }
+  materialState.paramChecks += material->paramCount;
+  if (materialState.current != material)
+    materialState.materialSwitches++;
+  materialState.current = material;
+}
+
+void Material_printStats(void)
+{
+  printf("materials: %lu draws, %lu program switches, %lu material switches, %lu params checked\n",
+         materialState.draws, materialState.programSwitches,
+         materialState.materialSwitches, materialState.paramChecks);
+}
+
+RenderQueue_T RenderQueue_new(void)
+{
+  RenderQueue_T queue = (RenderQueue_T)calloc(1, sizeof(struct RenderQueue_T));
+  if (queue == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  return queue;
+}
+
+void RenderQueue_free(RenderQueue_T queue)
+{
+  free(queue->draws);
+  free(queue);
+}
+
+void RenderQueue_drawArrays(RenderQueue_T queue, Material_T material, unsigned int vertexArray,
+                            GLenum mode, int first, int count)
+{
+  struct QueuedDraw* draw = queueDraw(queue, material, vertexArray);
+  draw->mode = mode;
+  draw->first = first;
+  draw->count = count;
+}
+
+void RenderQueue_drawElements(RenderQueue_T queue, Material_T material, unsigned int vertexArray,
+                              GLenum mode, int count, GLenum type, size_t offset)
+{
+  struct QueuedDraw* draw = queueDraw(queue, material, vertexArray);
+  draw->mode = mode;
+  draw->indexed = true;
+  draw->count = count;
+  draw->type = type;
+  draw->offset = offset;
+}
+
+/* submits everything queued since the last flush and empties the queue */
+void RenderQueue_flush(RenderQueue_T queue)
+{
+  qsort(queue->draws, queue->count, sizeof(struct QueuedDraw), compareDraws);
+  for (int i = 0; i < queue->count; i++)
+  {
+    const struct QueuedDraw* draw = &queue->draws[i];
+    Material_bind(draw->material);
+    GLState_bindVertexArray(draw->vertexArray);
+    ShaderPrewarm_record(draw->material->shader, draw->mode);
+    if (draw->indexed)
+      glDrawElements(draw->mode, draw->count, draw->type, (const void*)draw->offset);
+    else
+      glDrawArrays(draw->mode, draw->first, draw->count);
+  }
+  materialState.draws += queue->count;
+  queue->count = 0;
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* the named parameter, added on first use */
+struct MaterialParam* materialParam(Material_T material, const char* name, GLenum type)
+{
+  for (int i = 0; i < material->paramCount; i++)
+  {
+    if (strcmp(material->params[i].name, name) == 0)
+    {
+      material->params[i].type = type;
+      return &material->params[i];
+    }
+  }
+  struct MaterialParam* params = (struct MaterialParam*)realloc(
+    material->params, (material->paramCount + 1) * sizeof(struct MaterialParam));
+  char* copy = (char*)malloc(strlen(name) + 1);
+  if (params == NULL || copy == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(copy, name);
+  material->params = params;
+  struct MaterialParam* param = &material->params[material->paramCount++];
+  param->name = copy;
+  param->uniform = Shader_uniform(material->shader, name);
+  param->type = type;
+  param->value.i = 0;
+  return param;
+}
+
+struct QueuedDraw* queueDraw(RenderQueue_T queue, Material_T material, unsigned int vertexArray)
+{
+  if (queue->count == queue->capacity)
+  {
+    int capacity = queue->capacity ? 2 * queue->capacity : 64;
+    struct QueuedDraw* draws = (struct QueuedDraw*)
+      realloc(queue->draws, capacity * sizeof(struct QueuedDraw));
+    if (draws == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    queue->draws = draws;
+    queue->capacity = capacity;
+  }
+  struct QueuedDraw* draw = &queue->draws[queue->count];
+  memset(draw, 0, sizeof(*draw));
+  draw->key = (uint64_t)material->shader->ID << 32 | material->id;
+  draw->order = queue->count++;
+  draw->material = material;
+  draw->vertexArray = vertexArray;
+  return draw;
+}
+
+/* program, then material, then vertex array, then submission order */
+int compareDraws(const void* a, const void* b)
+{
+  const struct QueuedDraw* x = (const struct QueuedDraw*)a;
+  const struct QueuedDraw* y = (const struct QueuedDraw*)b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  if (x->vertexArray != y->vertexArray)
+    return x->vertexArray < y->vertexArray ? -1 : 1;
+  return x->order - y->order;
+}
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+/**
+ * Program Cache
+ * -------------
+ * Persists linked program binaries (GL_ARB_get_program_binary) on disk so
+ * the next launch can skip compiling and linking. Entries are keyed by a
+ * hash of both shader sources and the GL vendor/renderer/version strings,
+ * so a driver update simply turns into misses.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "gl_ext.h"
+
+#define PROGRAM_CACHE_MAGIC 0x42504C47u /* "GLPB" */
+#define PROGRAM_CACHE_PATH_MAX 512
+
+bool ProgramCache_open(const char* directory);
+uint64_t ProgramCache_key(const char* vertexCode, size_t vertexLength,
+                          const char* fragmentCode, size_t fragmentLength);
+bool ProgramCache_load(uint64_t key, unsigned int program);
+void ProgramCache_prepare(unsigned int program);
+void ProgramCache_store(uint64_t key, unsigned int program);
+void ProgramCache_printStats(void);
+/* utility functions */
+static uint64_t hashBytes64(uint64_t hash, const void* data, size_t length);
+static void cacheEntryPath(uint64_t key, char* path);
+
+struct ProgramCacheHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t key;
+  uint32_t length;
+  uint32_t reserved;
+};
+
+static struct {
+  bool enabled;
+  char directory[PROGRAM_CACHE_PATH_MAX - 32]; /* room for "/<key>.bin" */
+  uint64_t driverHash; /* vendor, renderer and version strings */
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int stores;
+} programCache;
+
+/* GLExt_load must have run; returns false when the driver can't cache */
+bool ProgramCache_open(const char* directory)
+{
+  int formats = 0;
+  if (!GLEXT_ARB_get_program_binary)
+    return false;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats < 1)
+    return false;
+
+#ifdef _WIN32
+  if (_mkdir(directory) != 0 && errno != EEXIST)
+#else
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+#endif
+  {
+    perror("mkdir");
+    return false;
+  }
+
+  snprintf(programCache.directory, sizeof(programCache.directory), "%s", directory);
+  uint64_t hash = 14695981039346656037ull;
+  const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  for (int i = 0; i < 3; i++)
+  {
+    const char* value = (const char*)glGetString(strings[i]);
+    if (value)
+      hash = hashBytes64(hash, value, strlen(value));
+  }
+  programCache.driverHash = hash;
+  programCache.enabled = true;
+  return true;
+}
+
+uint64_t ProgramCache_key(const char* vertexCode, size_t vertexLength,
+                          const char* fragmentCode, size_t fragmentLength)
+{
+  uint64_t hash = programCache.driverHash;
+  /* mix in the lengths so moving text between the stages changes the key */
+  hash = hashBytes64(hash, &vertexLength, sizeof(vertexLength));
+  hash = hashBytes64(hash, vertexCode, vertexLength);
+  hash = hashBytes64(hash, &fragmentLength, sizeof(fragmentLength));
+  hash = hashBytes64(hash, fragmentCode, fragmentLength);
+  return hash;
+}
+
+/* on success the program is linked and ready; otherwise count a miss */
+bool ProgramCache_load(uint64_t key, unsigned int program)
+{
+  if (!programCache.enabled)
+    return false;
+
+  char path[PROGRAM_CACHE_PATH_MAX];
+  struct ProgramCacheHeader header;
+  void* binary = NULL;
+  int success = 0;
+
+  cacheEntryPath(key, path);
+  FILE* file = fopen(path, "rb");
+  if (file)
+  {
+    /* the binary must fill the rest of the file exactly; a truncated or
+       corrupt entry is a miss, never a huge allocation */
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0)
+      size = ftell(file);
+    rewind(file);
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        header.magic == PROGRAM_CACHE_MAGIC && header.key == key &&
+        header.length > 0 && (uint64_t)size == sizeof(header) + (uint64_t)header.length &&
+        (binary = malloc(header.length)) != NULL &&
+        fread(binary, 1, header.length, file) == header.length)
+    {
+      glProgramBinary(program, (GLenum)header.format, binary, (GLsizei)header.length);
+      /* the driver rejects binaries it no longer understands */
+      glGetProgramiv(program, GL_LINK_STATUS, &success);
+    }
+    free(binary);
+    fclose(file);
+  }
+
+  if (success)
+    programCache.hits++;
+  else
+    programCache.misses++;
+  return success != 0;
+}
+
+/* must be called before glLinkProgram for the binary to be retrievable */
+void ProgramCache_prepare(unsigned int program)
+{
+  if (programCache.enabled)
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache_store(uint64_t key, unsigned int program)
+{
+  if (!programCache.enabled)
+    return;
+
+  int success = 0;
+  int length = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (!success || length <= 0)
+    return;
+
+  struct ProgramCacheHeader header = { PROGRAM_CACHE_MAGIC, 0, key, (uint32_t)length, 0 };
+  GLenum format = 0;
+  void* binary = malloc(length);
+  if (binary == NULL)
+    return;
+  glGetProgramBinary(program, length, NULL, &format, binary);
+  header.format = format;
+
+  char path[PROGRAM_CACHE_PATH_MAX];
+  cacheEntryPath(key, path);
+  FILE* file = fopen(path, "wb");
+  if (file)
+  {
+    if (fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(binary, 1, length, file) == (size_t)length)
+      programCache.stores++;
+    if (fclose(file))
+      perror("fclose");
+  }
+  free(binary);
+}
+
+void ProgramCache_printStats(void)
+{
+  if (!programCache.enabled)
+    return;
+  printf("program cache: %u hits, %u misses, %u stored\n",
+         programCache.hits, programCache.misses, programCache.stores);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* FNV-1a, 64 bit */
+uint64_t hashBytes64(uint64_t hash, const void* data, size_t length)
+{
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+void cacheEntryPath(uint64_t key, char* path)
+{
+  snprintf(path, PROGRAM_CACHE_PATH_MAX, "%s/%016llx.bin",
+           programCache.directory, (unsigned long long)key);
+}
+
+#endif
@@ -1,8 +1,15 @@
 #version 330 core
 out vec4 FragColor;  
 in vec3 ourColor;
+uniform float brightness; // set per material
+uniform float exposure; // unpinned, never changes, so Shader_specialize bakes it
   
 void main()
 {
-    FragColor = vec4(ourColor, 1.0);
+#ifdef GRAYSCALE
+    float luma = dot(ourColor, vec3(0.299, 0.587, 0.114));
+    FragColor = vec4(vec3(luma) * brightness * exposure, 1.0);
+#else
+    FragColor = vec4(ourColor * brightness * exposure, 1.0);
+#endif
 }
\ No newline at end of file
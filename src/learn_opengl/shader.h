@@ -2,150 +2,1578 @@
 #define SHADER_H
 
 #include <glad/gl.h>
+#include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "explicit_uniforms.h"
+#include "file_watch.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader_include.h"
+#include "shader_optimize.h"
+#include "shader_registry.h"
+#include "shader_source.h"
+#include "shader_timing.h"
 
 typedef struct Shader_T* Shader_T;
+struct PendingProgram;
+struct ProgramReflection;
+struct UniformInfo;
+struct UniformValue;
+struct Specialization;
+
+/* from Shader_uniform; index into the shader's handle table */
+typedef int ShaderUniform;
 
 Shader_T Shader_new(const char* vertexPath, const char* fragmentPath);
+Shader_T Shader_newFromMemory(const char* vertexCode, size_t vertexLength,
+                              const char* fragmentCode, size_t fragmentLength);
+bool Shader_newBatch(const char** vertexPaths, const char** fragmentPaths,
+                     int count, Shader_T* shaders);
+bool Shader_newBatchFromSources(const struct ShaderSource* vertexSources,
+                                const struct ShaderSource* fragmentSources,
+                                int count, Shader_T* shaders);
+void Shader_free(Shader_T sh);
 void Shader_use(Shader_T sh);
 void Shader_setBool(Shader_T sh, const char* name, bool value);
 void Shader_setInt(Shader_T sh, const char* name, int value);
 void Shader_setFloat(Shader_T sh, const char* name, float value);
+ShaderUniform Shader_uniform(Shader_T sh, const char* name);
+void Shader_setBoolAt(Shader_T sh, ShaderUniform uniform, bool value);
+void Shader_setIntAt(Shader_T sh, ShaderUniform uniform, int value);
+void Shader_setFloatAt(Shader_T sh, ShaderUniform uniform, float value);
+void Shader_printReflection(Shader_T sh);
+void Shader_printUniformStats(void);
+bool Shader_bindUniformBlock(Shader_T sh, const char* block, unsigned int binding);
+bool Shader_watch(Shader_T sh);
+void Shader_pollReloads(void);
+bool Shader_specialize(Shader_T sh, int warmupFrames);
+void Shader_pollSpecializations(void);
 /* utility functions */
-static void getFileLength(FILE* file, long* length);
-static void checkCompileErrors(unsigned int shaderID, const char* type);
+static char* copyString(const char* string);
+static void submitProgram(const struct ShaderSource* vertexSource,
+                          const struct ShaderSource* fragmentSource,
+                          struct PendingProgram* pending);
+static unsigned int compileStage(GLenum type, const struct ShaderSource* source);
+static bool programReady(const struct PendingProgram* pending);
+static bool finishProgram(struct PendingProgram* pending);
+static void startReload(Shader_T sh);
+static void finishReload(Shader_T sh);
+static void onShaderFileChanged(void* tag, const char* path);
+static bool watchSources(Shader_T sh);
+static void watchSourceFile(const char* path, void* user);
+static void applyBlockBindings(Shader_T sh);
+static void startSpecialization(Shader_T sh);
+static void finishSpecialization(Shader_T sh);
+static bool unbakeUniform(Shader_T sh, const char* name, GLenum type, const void* value);
+static void revertSpecialization(Shader_T sh);
+static void dropSpecialization(Shader_T sh);
+static bool bakeUniforms(const struct ShaderSource* source, const struct Specialization* special,
+                         struct ShaderSource* baked);
+static bool checkCompileErrors(unsigned int shaderID, const char* type);
+static uint32_t hashUniformName(const char* name);
+static void insertUniform(struct ProgramReflection* reflection, const char* name,
+                          size_t nameLength, int index);
+static void reflectProgram(Shader_T sh);
+static void reflectUniforms(unsigned int program, struct ProgramReflection* reflection);
+static void reflectAttributes(unsigned int program, struct ProgramReflection* reflection);
+static void reflectBlocks(unsigned int program, struct ProgramReflection* reflection);
+static void freeReflection(struct ProgramReflection* reflection);
+static int findUniform(const struct ProgramReflection* reflection, const char* name);
+static int resolveUniform(Shader_T sh, const char* name);
+static void growLookup(struct ProgramReflection* reflection);
+static int findBlock(const struct ProgramReflection* reflection, const char* name);
+static bool checkUniformType(struct UniformInfo* uniform, GLenum setterType);
+static bool isSamplerType(GLenum type);
+static const char* glslTypeName(GLenum type);
+static void setUniformInt(Shader_T sh, int index, GLenum setterType, int value);
+static void setUniformFloat(Shader_T sh, int index, float value);
+static bool shadowUniform(struct UniformInfo* uniform, GLenum type,
+                          const void* value, size_t size);
+static void uploadUniform(int location, const struct UniformValue* value);
+static void restoreUniforms(Shader_T sh, const struct ProgramReflection* old);
+
+/* uniform name -> index into ProgramReflection uniforms */
+struct UniformEntry {
+  char* name;
+  int index; /* "name" and "name[0]" share one */
+};
+
+/* last value sent to the program, so repeated sets can be skipped */
+struct UniformValue {
+  GLenum type; /* GL_NONE until the first set */
+  unsigned char data[16];
+};
+
+/* an active uniform as the driver reported it after link */
+struct UniformInfo {
+  char* name;
+  GLenum type;
+  int size; /* array length, 1 if not an array */
+  int location; /* -1 for members of a uniform block */
+  int block; /* uniform block index, -1 in the default block */
+  bool typeReported; /* a setter mismatch was already printed */
+  bool element; /* "name[N]" of an array, added when first set by that name */
+  int changes; /* sets that changed the value since the last link */
+  int watchedChanges; /* changes when the specialization warm-up began */
+  struct UniformValue value;
+};
+
+struct AttributeInfo {
+  char* name;
+  GLenum type;
+  int size;
+  int location;
+};
+
+struct BlockInfo {
+  char* name;
+  unsigned int index;
+  int dataSize; /* bytes the bound buffer range must cover */
+  int memberCount;
+};
+
+/* everything read back from a linked program, rebuilt on every relink */
+struct ProgramReflection {
+  struct UniformEntry* lookup; /* open addressing, capacity is a power of two */
+  unsigned int lookupCapacity;
+  unsigned int lookupCount;
+  struct UniformInfo* uniforms; /* in active uniform order, then array elements */
+  int uniformCount;
+  struct AttributeInfo* attributes;
+  int attributeCount;
+  struct BlockInfo* blocks;
+  int blockCount;
+};
+
+/* a uniform resolved once by name; re-resolved whenever the program relinks */
+struct UniformHandle {
+  char* name;
+  int index; /* into the reflected uniforms, -1 if not active */
+};
 
 struct Shader_T {
   unsigned int ID;
+  struct ProgramReflection reflection;
+  struct UniformHandle* handles;
+  int handleCount;
+  struct BlockBinding* blocks; /* kept so a relink can re-apply them */
+  int blockCount;
+  char* vertexPath;
+  char* fragmentPath;
+  uint64_t key; /* hash of the sources, see ProgramCache_key */
+  unsigned int vertex;   /* shared stage objects, 0 when loaded from the cache */
+  unsigned int fragment;
+  int timing;   /* ShaderTiming record of the current program */
+  bool used;    /* the first Shader_use is timed */
+  /* hot reload */
+  bool reloadRequested;
+  struct PendingProgram* reload; /* rebuild in flight, NULL when idle */
+  struct Specialization* special; /* NULL unless Shader_specialize was called */
+};
+
+/* uniform block name -> buffer binding point */
+struct BlockBinding {
+  char* name;
+  unsigned int binding;
+};
+
+/* a program whose compile/link was submitted but not yet checked */
+struct PendingProgram {
+  unsigned int program;
+  unsigned int vertex;
+  unsigned int fragment;
+  uint64_t cacheKey;
+  bool fromCache;
+  bool missingSource;
+  int timing;
+};
+
+/* a uniform compiled into the specialized program as a constant */
+struct BakedUniform {
+  char* name;
+  char glslType[8];  /* as the program reported it */
+  char literal[32];  /* its value as GLSL */
+  struct UniformValue value;
+};
+
+/**
+ * Watching: build is NULL. Building: build is in flight, generic is 0.
+ * Active: the shader's ID is build->program and generic is the program it
+ * replaced, kept for a fallback. Done: nothing more will happen.
+*/
+struct Specialization {
+  int warmupFrames;
+  int frames; /* polls since watching started */
+  bool done;
+  struct PendingProgram* build;
+  unsigned int generic;
+  struct BakedUniform* baked;
+  int bakedCount;
 };
 
+/* passed through ShaderInclude_forEachDependency by watchSources */
+struct WatchContext {
+  Shader_T sh;
+  bool watched;
+};
+
+/* counts of glUniform calls made and skipped because the value was current */
+static struct {
+  unsigned long issued;
+  unsigned long skipped;
+} uniformStats;
+
+/* programs registered with Shader_watch */
+static struct {
+  Shader_T* shaders;
+  int count;
+  int capacity;
+} watchedShaders;
+
+/* programs registered with Shader_specialize */
+static struct {
+  Shader_T* shaders;
+  int count;
+  int capacity;
+} specializedShaders;
+
 Shader_T Shader_new(const char* vertexPath, const char* fragmentPath) {
-  char* vertexCode = NULL;
-  char* fragmentCode = NULL;
-  long length = 0;
-  
-  Shader_T sh = (Shader_T)malloc(sizeof(struct Shader_T));
-  if (sh == NULL) {
+  Shader_T sh = NULL;
+  Shader_newBatch(&vertexPath, &fragmentPath, 1, &sh);
+  return sh;
+}
+
+/**
+ * Builds a program from sources compiled into the executable (see
+ * cmake/embed_shaders.cmake). #include lines should only name text
+ * registered with ShaderInclude_define, since anything else is looked up
+ * on disk. The program can't be watched.
+*/
+Shader_T Shader_newFromMemory(const char* vertexCode, size_t vertexLength,
+                              const char* fragmentCode, size_t fragmentLength)
+{
+  struct ShaderSource vertexSource = { vertexCode, (GLint)vertexLength, SHADER_SOURCE_STATIC };
+  struct ShaderSource fragmentSource = { fragmentCode, (GLint)fragmentLength, SHADER_SOURCE_STATIC };
+  ShaderInclude_expand("<vertex>", &vertexSource);
+  ShaderInclude_expand("<fragment>", &fragmentSource);
+  Shader_T sh = NULL;
+  Shader_newBatchFromSources(&vertexSource, &fragmentSource, 1, &sh);
+  return sh;
+}
+
+/**
+ * Every compile and link in the batch is handed to the driver before any
+ * status is read back, so with GL_KHR_parallel_shader_compile the driver's
+ * compiler threads work on all programs at once. Returns false if any
+ * program failed to build; the errors are printed as in Shader_new.
+*/
+bool Shader_newBatch(const char** vertexPaths, const char** fragmentPaths,
+                     int count, Shader_T* shaders)
+{
+  /* load every source file in one pass, vertex stages first */
+  const char** paths = (const char**)malloc(2 * (count > 0 ? count : 1) * sizeof(const char*));
+  struct ShaderSource* sources =
+    (struct ShaderSource*)malloc(2 * (count > 0 ? count : 1) * sizeof(struct ShaderSource));
+  if (paths == NULL || sources == NULL) {
     printf("Memory not allocated.\n");
     exit(EXIT_FAILURE);
   }
-  /* retrieve vertex and fragment source code from filePath */
-  /* ------------------------------------------------------ */
-  FILE* vShaderFile = fopen(vertexPath, "rb");
-  FILE* fShaderFile = fopen(fragmentPath, "rb");
-  if (!vShaderFile || !fShaderFile)
+  memcpy(paths, vertexPaths, count * sizeof(const char*));
+  memcpy(paths + count, fragmentPaths, count * sizeof(const char*));
+  double start = ShaderTiming_now();
+  ShaderInclude_loadMany(paths, 2 * count, sources);
+  /* read together for readahead, so each program gets an equal share */
+  double readMs = (ShaderTiming_now() - start) / (count > 0 ? count : 1);
+
+  bool success = Shader_newBatchFromSources(sources, sources + count, count, shaders);
+  for (int i = 0; i < count; i++)
   {
-    perror("fopen");
+    shaders[i]->vertexPath = copyString(vertexPaths[i]);
+    shaders[i]->fragmentPath = copyString(fragmentPaths[i]);
+    ShaderTiming_label(shaders[i]->timing, vertexPaths[i], fragmentPaths[i]);
+    ShaderTiming_add(shaders[i]->timing, SHADER_TIMING_READ, readMs);
+  }
+
+  for (int i = 0; i < 2 * count; i++)
+    ShaderSource_release(&sources[i]);
+  free(sources);
+  free(paths);
+  return success;
+}
+
+/**
+ * Same as Shader_newBatch for sources already in memory. The programs have
+ * no paths, so they can't be watched for reloads. The sources may be
+ * released as soon as this returns.
+*/
+bool Shader_newBatchFromSources(const struct ShaderSource* vertexSources,
+                                const struct ShaderSource* fragmentSources,
+                                int count, Shader_T* shaders)
+{
+  bool success = true;
+  struct PendingProgram* pending =
+    (struct PendingProgram*)calloc(count > 0 ? count : 1, sizeof(struct PendingProgram));
+  if (pending == NULL) {
+    printf("Memory not allocated.\n");
     exit(EXIT_FAILURE);
   }
 
-  getFileLength(vShaderFile, &length);
-  vertexCode = (char*)malloc(length + 1);
-  /* copy contents of file into vertexCode */
-  if (vertexCode)
+  if (GLEXT_KHR_parallel_shader_compile)
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); /* let the driver decide */
+
+  for (int i = 0; i < count; i++)
   {
-    if (fread(vertexCode, 1, length, vShaderFile) != length)
+    shaders[i] = (Shader_T)calloc(1, sizeof(struct Shader_T));
+    if (shaders[i] == NULL) {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    pending[i].timing = ShaderTiming_begin(false);
+    submitProgram(&vertexSources[i], &fragmentSources[i], &pending[i]);
+  }
+
+  /* only now block on the results */
+  for (int i = 0; i < count; i++)
+  {
+    success &= finishProgram(&pending[i]);
+    shaders[i]->ID = pending[i].program;
+    shaders[i]->key = pending[i].cacheKey;
+    shaders[i]->vertex = pending[i].vertex;
+    shaders[i]->fragment = pending[i].fragment;
+    shaders[i]->timing = pending[i].timing;
+    reflectProgram(shaders[i]);
+  }
+
+  free(pending);
+  return success;
+}
+
+void Shader_free(Shader_T sh) {
+  for (int i = 0; i < watchedShaders.count; i++)
+  {
+    if (watchedShaders.shaders[i] == sh)
     {
-      perror("fread");
+      watchedShaders.shaders[i] = watchedShaders.shaders[--watchedShaders.count];
+      FileWatch_remove(sh);
+      break;
+    }
+  }
+  for (int i = 0; i < specializedShaders.count; i++)
+  {
+    if (specializedShaders.shaders[i] == sh)
+    {
+      specializedShaders.shaders[i] = specializedShaders.shaders[--specializedShaders.count];
+      break;
+    }
+  }
+  if (sh->special)
+  {
+    /* leaves sh->ID as the generic program, deleted below */
+    dropSpecialization(sh);
+    free(sh->special);
+  }
+  if (sh->reload)
+  {
+    finishProgram(sh->reload);
+    glDeleteProgram(sh->reload->program);
+    ShaderRegistry_release(sh->reload->vertex);
+    ShaderRegistry_release(sh->reload->fragment);
+    free(sh->reload);
+  }
+  glDeleteProgram(sh->ID);
+  ShaderRegistry_release(sh->vertex);
+  ShaderRegistry_release(sh->fragment);
+  freeReflection(&sh->reflection);
+  for (int i = 0; i < sh->handleCount; i++)
+    free(sh->handles[i].name);
+  free(sh->handles);
+  for (int i = 0; i < sh->blockCount; i++)
+    free(sh->blocks[i].name);
+  free(sh->blocks);
+  free(sh->vertexPath);
+  free(sh->fragmentPath);
+  free(sh);
+}
+
+void Shader_use(Shader_T sh) {
+  if (!sh->used)
+  {
+    /* drivers may defer work until the program is first made current */
+    double start = ShaderTiming_now();
+    GLState_useProgram(sh->ID);
+    ShaderTiming_add(sh->timing, SHADER_TIMING_FIRST_USE, ShaderTiming_now() - start);
+    sh->used = true;
+    return;
+  }
+  GLState_useProgram(sh->ID);
+}
+
+/* a name missing from the program may be one baked by Shader_specialize */
+void Shader_setBool(Shader_T sh, const char* name, bool value)
+{
+  int index = resolveUniform(sh, name);
+  int data = (int)value;
+  if (index == -1 && unbakeUniform(sh, name, GL_INT, &data))
+    index = resolveUniform(sh, name);
+  setUniformInt(sh, index, GL_BOOL, data);
+}
+
+void Shader_setInt(Shader_T sh, const char* name, int value)
+{
+  int index = resolveUniform(sh, name);
+  if (index == -1 && unbakeUniform(sh, name, GL_INT, &value))
+    index = resolveUniform(sh, name);
+  setUniformInt(sh, index, GL_INT, value);
+}
+
+void Shader_setFloat(Shader_T sh, const char* name, float value)
+{
+  int index = resolveUniform(sh, name);
+  if (index == -1 && unbakeUniform(sh, name, GL_FLOAT, &value))
+    index = resolveUniform(sh, name);
+  setUniformFloat(sh, index, value);
+}
+
+/**
+ * Looks a uniform up by name once so per-frame sets are an array index
+ * instead of a hash. The handle lives as long as the shader and follows
+ * the uniform across hot reloads. A name the program doesn't use is
+ * reported here, and sets through its handle do nothing.
+*/
+ShaderUniform Shader_uniform(Shader_T sh, const char* name)
+{
+  for (int i = 0; i < sh->handleCount; i++)
+    if (strcmp(sh->handles[i].name, name) == 0)
+      return i;
+
+  struct UniformHandle* handles = (struct UniformHandle*)realloc(
+    sh->handles, (sh->handleCount + 1) * sizeof(struct UniformHandle));
+  if (handles == NULL) {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  sh->handles = handles;
+  struct UniformHandle* handle = &sh->handles[sh->handleCount];
+  handle->name = copyString(name);
+  handle->index = resolveUniform(sh, name);
+  if (handle->index == -1)
+    printf("WARNING::SHADER no active uniform named %s\n", name);
+  return sh->handleCount++;
+}
+
+void Shader_setBoolAt(Shader_T sh, ShaderUniform uniform, bool value)
+{
+  int data = (int)value;
+  if (sh->handles[uniform].index == -1)
+    unbakeUniform(sh, sh->handles[uniform].name, GL_INT, &data);
+  setUniformInt(sh, sh->handles[uniform].index, GL_BOOL, data);
+}
+
+void Shader_setIntAt(Shader_T sh, ShaderUniform uniform, int value)
+{
+  if (sh->handles[uniform].index == -1)
+    unbakeUniform(sh, sh->handles[uniform].name, GL_INT, &value);
+  setUniformInt(sh, sh->handles[uniform].index, GL_INT, value);
+}
+
+void Shader_setFloatAt(Shader_T sh, ShaderUniform uniform, float value)
+{
+  if (sh->handles[uniform].index == -1)
+    unbakeUniform(sh, sh->handles[uniform].name, GL_FLOAT, &value);
+  setUniformFloat(sh, sh->handles[uniform].index, value);
+}
+
+/* dump what the linker kept: attributes, uniforms and uniform blocks */
+void Shader_printReflection(Shader_T sh)
+{
+  const struct ProgramReflection* reflection = &sh->reflection;
+  int active = 0;
+  for (int i = 0; i < reflection->uniformCount; i++)
+    active += !reflection->uniforms[i].element;
+  printf("program %u: %d attributes, %d uniforms, %d uniform blocks\n", sh->ID,
+         reflection->attributeCount, active, reflection->blockCount);
+  for (int i = 0; i < reflection->attributeCount; i++)
+  {
+    const struct AttributeInfo* attribute = &reflection->attributes[i];
+    printf("  in %s %s (location %d)\n", glslTypeName(attribute->type),
+           attribute->name, attribute->location);
+  }
+  for (int i = 0; i < reflection->uniformCount; i++)
+  {
+    const struct UniformInfo* uniform = &reflection->uniforms[i];
+    if (uniform->element)
+      continue;
+    if (uniform->block != -1)
+      printf("  uniform %s %s (block %s)\n", glslTypeName(uniform->type), uniform->name,
+             reflection->blocks[uniform->block].name);
+    else
+      printf("  uniform %s %s (location %d)\n", glslTypeName(uniform->type), uniform->name,
+             uniform->location);
+  }
+  for (int i = 0; i < reflection->blockCount; i++)
+  {
+    const struct BlockInfo* block = &reflection->blocks[i];
+    printf("  block %s: %d bytes, %d members\n", block->name, block->dataSize,
+           block->memberCount);
+  }
+}
+
+void Shader_printUniformStats(void)
+{
+  printf("uniforms: %lu issued, %lu skipped\n", uniformStats.issued, uniformStats.skipped);
+}
+
+/* point a uniform block at a buffer binding (see UniformRing_bind) */
+bool Shader_bindUniformBlock(Shader_T sh, const char* block, unsigned int binding)
+{
+  int i = 0;
+  while (i < sh->blockCount && strcmp(sh->blocks[i].name, block) != 0)
+    i++;
+  if (i == sh->blockCount)
+  {
+    struct BlockBinding* blocks =
+      (struct BlockBinding*)realloc(sh->blocks, (sh->blockCount + 1) * sizeof(struct BlockBinding));
+    if (blocks == NULL) {
+      printf("Memory not allocated.\n");
       exit(EXIT_FAILURE);
     }
-    vertexCode[length] = '\0';
+    sh->blocks = blocks;
+    sh->blocks[i].name = copyString(block);
+    sh->blockCount++;
   }
+  sh->blocks[i].binding = binding;
+  applyBlockBindings(sh);
+  return findBlock(&sh->reflection, block) != -1;
+}
+
+/**
+ * Rebuild the program whenever one of its source files changes on disk.
+ * Nothing happens until Shader_pollReloads is called.
+*/
+bool Shader_watch(Shader_T sh)
+{
+  if (sh->vertexPath == NULL || sh->fragmentPath == NULL)
+    return false;
+  if (!watchSources(sh))
+  {
+    FileWatch_remove(sh);
+    return false;
+  }
+  if (watchedShaders.count == watchedShaders.capacity)
+  {
+    int capacity = watchedShaders.capacity ? watchedShaders.capacity * 2 : 8;
+    Shader_T* shaders = (Shader_T*)realloc(watchedShaders.shaders, capacity * sizeof(Shader_T));
+    if (shaders == NULL) {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    watchedShaders.shaders = shaders;
+    watchedShaders.capacity = capacity;
+  }
+  watchedShaders.shaders[watchedShaders.count++] = sh;
+  return true;
+}
+
+/**
+ * Call once per frame, between frames. Changed programs are recompiled in
+ * the background (GL_KHR_parallel_shader_compile) and swapped in on a later
+ * poll, only if they link; a broken edit leaves the previous program live.
+ * Without the extension the compile runs synchronously inside this call.
+*/
+void Shader_pollReloads(void)
+{
+  FileWatch_poll(onShaderFileChanged);
+  for (int i = 0; i < watchedShaders.count; i++)
+  {
+    Shader_T sh = watchedShaders.shaders[i];
+    if (sh->reload && programReady(sh->reload))
+      finishReload(sh);
+    if (sh->reloadRequested && sh->reload == NULL)
+      startReload(sh);
+  }
+}
+
+/**
+ * Opt-in: watches the Shader_set* traffic for warmupFrames polls after the
+ * first, then rebuilds the program in the background with every scalar
+ * uniform that kept its value all that time compiled in as a `const`, so
+ * the driver can fold it. While ExplicitUniforms_active, uniforms pinned
+ * by ExplicitUniforms_use are never baked, so they keep their location in
+ * every program. The specialized program replaces this one transparently.
+ * Setting a baked uniform to a different value switches back to the
+ * generic program for good. A hot reload starts the warm-up over. Needs
+ * the source paths, so programs built from memory can't be specialized.
+*/
+bool Shader_specialize(Shader_T sh, int warmupFrames)
+{
+  if (sh->vertexPath == NULL || sh->fragmentPath == NULL)
+  {
+    printf("ERROR::SHADER can't specialize a program without source files\n");
+    return false;
+  }
+  if (sh->special)
+    return true;
+  sh->special = (struct Specialization*)calloc(1, sizeof(struct Specialization));
+  if (sh->special == NULL) {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  sh->special->warmupFrames = warmupFrames;
+
+  if (specializedShaders.count == specializedShaders.capacity)
+  {
+    int capacity = specializedShaders.capacity ? specializedShaders.capacity * 2 : 8;
+    Shader_T* shaders = (Shader_T*)realloc(specializedShaders.shaders, capacity * sizeof(Shader_T));
+    if (shaders == NULL) {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    specializedShaders.shaders = shaders;
+    specializedShaders.capacity = capacity;
+  }
+  specializedShaders.shaders[specializedShaders.count++] = sh;
+  return true;
+}
+
+/* call once per frame, after the frame's uniforms were set */
+void Shader_pollSpecializations(void)
+{
+  for (int i = 0; i < specializedShaders.count; i++)
+  {
+    Shader_T sh = specializedShaders.shaders[i];
+    struct Specialization* special = sh->special;
+    if (special->done || sh->reload)
+      continue;
+    if (special->build == NULL)
+    {
+      if (++special->frames == 1)
+      {
+        /* sets made during setup and the first frame don't count */
+        for (int j = 0; j < sh->reflection.uniformCount; j++)
+          sh->reflection.uniforms[j].watchedChanges = sh->reflection.uniforms[j].changes;
+      }
+      else if (special->frames > special->warmupFrames)
+        startSpecialization(sh);
+    }
+    else if (special->generic == 0 && programReady(special->build))
+      finishSpecialization(sh);
+  }
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+char* copyString(const char* string)
+{
+  size_t length = strlen(string) + 1;
+  char* copy = (char*)malloc(length);
+  if (copy == NULL) {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(copy, string, length);
+  return copy;
+}
+
+/* issue everything needed to build the program without reading any status */
+void submitProgram(const struct ShaderSource* vertexSource,
+                   const struct ShaderSource* fragmentSource,
+                   struct PendingProgram* pending)
+{
+  if (vertexSource->storage == SHADER_SOURCE_NONE ||
+      fragmentSource->storage == SHADER_SOURCE_NONE)
+  {
+    pending->missingSource = true;
+    return;
+  }
+
+  /* try the on-disk program cache before compiling */
+  pending->cacheKey = ProgramCache_key(vertexSource->code, (size_t)vertexSource->length,
+                                       fragmentSource->code, (size_t)fragmentSource->length);
+  pending->cacheKey = ExplicitUniforms_key(pending->cacheKey);
+  double start = ShaderTiming_now();
+  pending->program = glCreateProgram();
+  pending->fromCache = ProgramCache_load(pending->cacheKey, pending->program);
+  ShaderTiming_setCached(pending->timing, pending->fromCache);
+  if (pending->fromCache)
+    ShaderTiming_add(pending->timing, SHADER_TIMING_LINK, ShaderTiming_now() - start);
+  else
+  {
+    start = ShaderTiming_now();
+    pending->vertex = compileStage(GL_VERTEX_SHADER, vertexSource);
+    ShaderTiming_add(pending->timing, SHADER_TIMING_VERTEX, ShaderTiming_now() - start);
+
+    start = ShaderTiming_now();
+    pending->fragment = compileStage(GL_FRAGMENT_SHADER, fragmentSource);
+    ShaderTiming_add(pending->timing, SHADER_TIMING_FRAGMENT, ShaderTiming_now() - start);
+
+    start = ShaderTiming_now();
+    glAttachShader(pending->program, pending->vertex);
+    glAttachShader(pending->program, pending->fragment);
+    ProgramCache_prepare(pending->program);
+    glLinkProgram(pending->program);
+    ShaderTiming_add(pending->timing, SHADER_TIMING_LINK, ShaderTiming_now() - start);
+  }
+}
+
+/**
+ * Takes the stage from the registry if another program has the same
+ * source. Otherwise optimizes the text, pins its uniforms to their
+ * explicit locations and compiles that. The driver copies the text, so
+ * the rewritten copies can go at once.
+*/
+unsigned int compileStage(GLenum type, const struct ShaderSource* source)
+{
+  struct ShaderSource optimized, located;
+  /* a stage another program compiled is shared before any rewriting */
+  unsigned int shader = ShaderRegistry_find(type, source);
+  if (shader != 0)
+    return shader;
+  bool isOptimized = ShaderOptimize_apply(type, source, &optimized);
+  const struct ShaderSource* text = isOptimized ? &optimized : source;
+  if (ExplicitUniforms_apply(text, &located))
+  {
+    shader = ShaderRegistry_add(type, source, &located);
+    ShaderSource_release(&located);
+  }
+  else
+    shader = ShaderRegistry_add(type, source, text);
+  if (isOptimized)
+    ShaderSource_release(&optimized);
+  return shader;
+}
+
+/* true once reading the status would no longer block */
+bool programReady(const struct PendingProgram* pending)
+{
+  int done = 1;
+  if (GLEXT_KHR_parallel_shader_compile && !pending->fromCache && !pending->missingSource)
+    glGetProgramiv(pending->program, GL_COMPLETION_STATUS_KHR, &done);
+  return done != 0;
+}
+
+/* read back compile/link status; blocks until the driver is done */
+bool finishProgram(struct PendingProgram* pending)
+{
+  bool success = !pending->missingSource;
+  if (success && !pending->fromCache)
+  {
+    double start = ShaderTiming_now();
+    success &= checkCompileErrors(pending->vertex, "VERTEX");
+    success &= checkCompileErrors(pending->fragment, "FRAGMENT");
+    success &= checkCompileErrors(pending->program, "PROGRAM");
+    ShaderTiming_add(pending->timing, SHADER_TIMING_STATUS, ShaderTiming_now() - start);
+    if (success)
+      ProgramCache_store(pending->cacheKey, pending->program);
+    else
+    {
+      /* no program keeps them; a fixed source has a different hash anyway */
+      ShaderRegistry_release(pending->vertex);
+      ShaderRegistry_release(pending->fragment);
+      pending->vertex = pending->fragment = 0;
+    }
+  }
+  return success;
+}
 
-  if (fclose(vShaderFile))
+void startReload(Shader_T sh)
+{
+  struct ShaderSource vertexSource, fragmentSource;
+  double start = ShaderTiming_now();
+  sh->reloadRequested = false;
+  /* the new sources may change what can be baked; watch them afresh */
+  if (sh->special)
+    dropSpecialization(sh);
+  /* the file may be mid-save; the next write event retries */
+  if (!ShaderInclude_load(sh->vertexPath, &vertexSource))
+    return;
+  if (!ShaderInclude_load(sh->fragmentPath, &fragmentSource))
   {
-    perror("fclose");
+    ShaderSource_release(&vertexSource);
+    return;
+  }
+
+  sh->reload = (struct PendingProgram*)calloc(1, sizeof(struct PendingProgram));
+  if (sh->reload == NULL) {
+    printf("Memory not allocated.\n");
     exit(EXIT_FAILURE);
   }
+  sh->reload->timing = ShaderTiming_begin(true);
+  ShaderTiming_label(sh->reload->timing, sh->vertexPath, sh->fragmentPath);
+  ShaderTiming_add(sh->reload->timing, SHADER_TIMING_READ, ShaderTiming_now() - start);
+  submitProgram(&vertexSource, &fragmentSource, sh->reload);
+  ShaderSource_release(&vertexSource);
+  ShaderSource_release(&fragmentSource);
+}
+
+void finishReload(Shader_T sh)
+{
+  if (finishProgram(sh->reload))
+  {
+    struct ProgramReflection old = sh->reflection;
+    unsigned int oldID = sh->ID;
+    unsigned int previous = GLState_program();
+
+    sh->ID = sh->reload->program;
+    sh->key = sh->reload->cacheKey;
+    sh->timing = sh->reload->timing;
+    reflectProgram(sh);
+    /* carry over everything set on the old program, then drop it */
+    double start = ShaderTiming_now();
+    GLState_useProgram(sh->ID);
+    ShaderTiming_add(sh->timing, SHADER_TIMING_FIRST_USE, ShaderTiming_now() - start);
+    restoreUniforms(sh, &old);
+    freeReflection(&old);
+    applyBlockBindings(sh);
+    GLState_useProgram(previous == oldID ? sh->ID : previous);
+    glDeleteProgram(oldID);
+    ShaderRegistry_release(sh->vertex);
+    ShaderRegistry_release(sh->fragment);
+    sh->vertex = sh->reload->vertex;
+    sh->fragment = sh->reload->fragment;
+    /* the edit may have added or dropped includes */
+    watchSources(sh);
+    printf("reloaded %s + %s\n", sh->vertexPath, sh->fragmentPath);
+  }
+  else
+  {
+    glDeleteProgram(sh->reload->program);
+    printf("keeping previous program for %s + %s\n", sh->vertexPath, sh->fragmentPath);
+  }
+  free(sh->reload);
+  sh->reload = NULL;
+}
 
-  getFileLength(fShaderFile, &length);
-  fragmentCode = (char*)malloc(length + 1);
-  /* copy contents of file into fragmentCode */
-  if (fragmentCode)
+/* bakes the uniforms that kept one value through the warm-up and submits the build */
+void startSpecialization(Shader_T sh)
+{
+  struct Specialization* special = sh->special;
+  struct ShaderSource vertexSource, fragmentSource, vertexBaked, fragmentBaked;
+  for (int i = 0; i < sh->reflection.uniformCount; i++)
   {
-    if (fread(fragmentCode, 1, length, fShaderFile) != length)
+    const struct UniformInfo* uniform = &sh->reflection.uniforms[i];
+    char literal[32];
+    if (uniform->block != -1 || uniform->location == -1 || uniform->size != 1 || uniform->element ||
+        uniform->value.type == GL_NONE || uniform->changes != uniform->watchedChanges ||
+        (ExplicitUniforms_active() && ExplicitUniforms_contains(uniform->name)))
+      continue;
+    if (uniform->type == GL_FLOAT && uniform->value.type == GL_FLOAT)
     {
-      perror("fread");
+      float value;
+      memcpy(&value, uniform->value.data, sizeof(value));
+      if (!isfinite(value))
+        continue;
+      snprintf(literal, sizeof(literal), "%.9g", value);
+      if (strpbrk(literal, ".e") == NULL)
+        strcat(literal, ".0");
+    }
+    else if (uniform->type == GL_INT && uniform->value.type == GL_INT)
+      snprintf(literal, sizeof(literal), "%d", *(const int*)uniform->value.data);
+    else if (uniform->type == GL_BOOL && uniform->value.type == GL_INT)
+      strcpy(literal, *(const int*)uniform->value.data ? "true" : "false");
+    else if (uniform->type == GL_BOOL && uniform->value.type == GL_FLOAT)
+      strcpy(literal, *(const float*)uniform->value.data != 0.0f ? "true" : "false");
+    else
+      continue; /* vectors, matrices and samplers stay uniforms */
+
+    struct BakedUniform* baked = (struct BakedUniform*)realloc(
+      special->baked, (special->bakedCount + 1) * sizeof(struct BakedUniform));
+    if (baked == NULL) {
+      printf("Memory not allocated.\n");
       exit(EXIT_FAILURE);
     }
-    fragmentCode[length] = '\0';
+    special->baked = baked;
+    baked = &special->baked[special->bakedCount++];
+    baked->name = copyString(uniform->name);
+    strcpy(baked->glslType, glslTypeName(uniform->type));
+    strcpy(baked->literal, literal);
+    baked->value = uniform->value;
+  }
+  special->done = true;
+  if (special->bakedCount == 0)
+    return;
+  if (!ShaderInclude_load(sh->vertexPath, &vertexSource))
+    return;
+  if (!ShaderInclude_load(sh->fragmentPath, &fragmentSource))
+  {
+    ShaderSource_release(&vertexSource);
+    return;
   }
 
-  if (fclose(fShaderFile))
+  /* a stage with nothing to bake is submitted as it is */
+  bool vertexChanged = bakeUniforms(&vertexSource, special, &vertexBaked);
+  bool fragmentChanged = bakeUniforms(&fragmentSource, special, &fragmentBaked);
+  if (vertexChanged || fragmentChanged)
   {
-    perror("fclose");
+    special->build = (struct PendingProgram*)calloc(1, sizeof(struct PendingProgram));
+    if (special->build == NULL) {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    special->build->timing = ShaderTiming_begin(false);
+    ShaderTiming_label(special->build->timing, sh->vertexPath, sh->fragmentPath);
+    submitProgram(vertexChanged ? &vertexBaked : &vertexSource,
+                  fragmentChanged ? &fragmentBaked : &fragmentSource, special->build);
+    special->done = false;
+  }
+  if (vertexChanged)
+    ShaderSource_release(&vertexBaked);
+  if (fragmentChanged)
+    ShaderSource_release(&fragmentBaked);
+  ShaderSource_release(&vertexSource);
+  ShaderSource_release(&fragmentSource);
+}
+
+/* swaps the specialized program in, keeping the generic one for a fallback */
+void finishSpecialization(Shader_T sh)
+{
+  struct Specialization* special = sh->special;
+  special->done = true;
+  if (!finishProgram(special->build))
+  {
+    glDeleteProgram(special->build->program);
+    free(special->build);
+    special->build = NULL;
+    printf("keeping generic program for %s + %s\n", sh->vertexPath, sh->fragmentPath);
+    return;
+  }
+  struct ProgramReflection old = sh->reflection;
+  unsigned int previous = GLState_program();
+
+  special->generic = sh->ID;
+  sh->ID = special->build->program;
+  reflectProgram(sh);
+  GLState_useProgram(sh->ID);
+  restoreUniforms(sh, &old);
+  freeReflection(&old);
+  applyBlockBindings(sh);
+  GLState_useProgram(previous == special->generic ? sh->ID : previous);
+  printf("specialized %s + %s, %d uniforms baked\n", sh->vertexPath, sh->fragmentPath,
+         special->bakedCount);
+}
+
+/* true if a set of a baked uniform to a new value switched back to generic */
+bool unbakeUniform(Shader_T sh, const char* name, GLenum type, const void* value)
+{
+  struct Specialization* special = sh->special;
+  if (special == NULL || special->generic == 0)
+    return false;
+  for (int i = 0; i < special->bakedCount; i++)
+  {
+    const struct BakedUniform* baked = &special->baked[i];
+    if (strcmp(baked->name, name) != 0)
+      continue;
+    if (baked->value.type == type && memcmp(baked->value.data, value, 4) == 0)
+      return false;
+    printf("%s changed, back to the generic program for %s + %s\n", name,
+           sh->vertexPath, sh->fragmentPath);
+    revertSpecialization(sh);
+    return true;
+  }
+  return false;
+}
+
+/* the generic program still holds the baked values, so only the rest move */
+void revertSpecialization(Shader_T sh)
+{
+  struct Specialization* special = sh->special;
+  struct ProgramReflection old = sh->reflection;
+  unsigned int specialized = sh->ID;
+  unsigned int previous = GLState_program();
+
+  sh->ID = special->generic;
+  reflectProgram(sh);
+  GLState_useProgram(sh->ID);
+  restoreUniforms(sh, &old);
+  freeReflection(&old);
+  applyBlockBindings(sh);
+  GLState_useProgram(previous == specialized ? sh->ID : previous);
+  glDeleteProgram(specialized);
+  ShaderRegistry_release(special->build->vertex);
+  ShaderRegistry_release(special->build->fragment);
+  free(special->build);
+  special->build = NULL;
+  special->generic = 0;
+  special->done = true;
+}
+
+/* back on the generic program and watching, as right after Shader_specialize */
+void dropSpecialization(Shader_T sh)
+{
+  struct Specialization* special = sh->special;
+  if (special->generic != 0)
+    revertSpecialization(sh);
+  else if (special->build)
+  {
+    finishProgram(special->build);
+    glDeleteProgram(special->build->program);
+    ShaderRegistry_release(special->build->vertex);
+    ShaderRegistry_release(special->build->fragment);
+    free(special->build);
+    special->build = NULL;
+  }
+  for (int i = 0; i < special->bakedCount; i++)
+    free(special->baked[i].name);
+  free(special->baked);
+  special->baked = NULL;
+  special->bakedCount = 0;
+  special->frames = 0;
+  special->done = false;
+}
+
+/**
+ * Rewrites each `uniform <type> <name>;` line of a baked uniform as
+ * `const <type> <name> = <value>;`, keeping the rest of the line, so
+ * line numbers don't move. Returns false, leaving baked untouched, if
+ * nothing was rewritten.
+*/
+bool bakeUniforms(const struct ShaderSource* source, const struct Specialization* special,
+                  struct ShaderSource* baked)
+{
+  const char* code = source->code;
+  size_t length = (size_t)source->length;
+  char* out = NULL;
+  size_t used = 0;
+  /* first pass counts the space, second writes */
+  for (int pass = 0; pass < 2; pass++)
+  {
+    size_t extra = 0;
+    for (size_t start = 0; start < length;)
+    {
+      const char* end = (const char*)memchr(code + start, '\n', length - start);
+      size_t next = end ? (size_t)(end - code) + 1 : length;
+      const struct BakedUniform* match = NULL;
+      size_t i = start, words[3], wordLengths[3];
+      int wordCount = 0;
+      while (i < next && (code[i] == ' ' || code[i] == '\t'))
+        i++;
+      size_t indent = i;
+      while (i < next && wordCount < 3)
+      {
+        words[wordCount] = i;
+        while (i < next && (isalnum((unsigned char)code[i]) || code[i] == '_'))
+          i++;
+        wordLengths[wordCount] = i - words[wordCount];
+        if (wordLengths[wordCount++] == 0)
+          break;
+        while (i < next && (code[i] == ' ' || code[i] == '\t'))
+          i++;
+      }
+      if (wordCount == 3 && wordLengths[2] > 0 && i < next && code[i] == ';' &&
+          wordLengths[0] == 7 && strncmp(code + words[0], "uniform", 7) == 0)
+      {
+        for (int j = 0; j < special->bakedCount && match == NULL; j++)
+        {
+          const struct BakedUniform* candidate = &special->baked[j];
+          if (strlen(candidate->name) == wordLengths[2] &&
+              strncmp(candidate->name, code + words[2], wordLengths[2]) == 0 &&
+              strlen(candidate->glslType) == wordLengths[1] &&
+              strncmp(candidate->glslType, code + words[1], wordLengths[1]) == 0)
+            match = candidate;
+        }
+      }
+      if (match == NULL)
+      {
+        if (out)
+          memcpy(out + used, code + start, next - start);
+        used += next - start;
+      }
+      else if (out)
+      {
+        memcpy(out + used, code + start, indent - start);
+        used += indent - start;
+        used += sprintf(out + used, "const %s %s = %s", match->glslType, match->name,
+                        match->literal);
+        memcpy(out + used, code + i, next - i);
+        used += next - i;
+      }
+      else
+        extra += strlen(match->glslType) + strlen(match->name) + strlen(match->literal) + 16;
+      start = next;
+    }
+    if (pass == 1)
+      break;
+    if (extra == 0)
+      return false;
+    out = (char*)malloc(length + extra + 1);
+    if (out == NULL) {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    used = 0;
+  }
+  baked->code = out;
+  baked->length = (GLint)used;
+  baked->storage = SHADER_SOURCE_HEAP;
+  return true;
+}
+
+void onShaderFileChanged(void* tag, const char* path)
+{
+  ShaderInclude_invalidate(path);
+  ((Shader_T)tag)->reloadRequested = true;
+}
+
+/* every included file too, so editing a header rebuilds only its users */
+bool watchSources(Shader_T sh)
+{
+  struct WatchContext context = { sh, true };
+  FileWatch_remove(sh);
+  ShaderInclude_forEachDependency(sh->vertexPath, watchSourceFile, &context);
+  ShaderInclude_forEachDependency(sh->fragmentPath, watchSourceFile, &context);
+  return context.watched;
+}
+
+void watchSourceFile(const char* path, void* user)
+{
+  struct WatchContext* context = (struct WatchContext*)user;
+  context->watched &= FileWatch_add(path, context->sh);
+}
+
+/* FNV-1a */
+uint32_t hashUniformName(const char* name)
+{
+  uint32_t hash = 2166136261u;
+  while (*name)
+  {
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void insertUniform(struct ProgramReflection* reflection, const char* name,
+                   size_t nameLength, int index)
+{
+  unsigned int mask = reflection->lookupCapacity - 1;
+  char* key = (char*)malloc(nameLength + 1);
+  if (key == NULL)
+  {
+    printf("Memory not allocated.\n");
     exit(EXIT_FAILURE);
   }
-  /* compile the shaders */
-  /* ------------------- */
-  const char* vShaderCode = vertexCode;
-  const char* fShaderCode = fragmentCode;
-  unsigned int vertex, fragment;
-
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
-  checkCompileErrors(vertex, "VERTEX");
-
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  checkCompileErrors(fragment, "FRAGMENT");
-
-  sh->ID = glCreateProgram();
-  glAttachShader(sh->ID, vertex);
-  glAttachShader(sh->ID, fragment);
-  glLinkProgram(sh->ID);
-  checkCompileErrors(sh->ID, "PROGRAM");
-  
-  // clean up
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
-  free(vertexCode);
-  free(fragmentCode);
+  memcpy(key, name, nameLength);
+  key[nameLength] = '\0';
 
-  return sh;
+  if ((reflection->lookupCount + 1) * 2 > reflection->lookupCapacity)
+  {
+    growLookup(reflection);
+    mask = reflection->lookupCapacity - 1;
+  }
+  unsigned int i = hashUniformName(key) & mask;
+  while (reflection->lookup[i].name != NULL)
+  {
+    if (strcmp(reflection->lookup[i].name, key) == 0)
+    {
+      free(key);
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  reflection->lookup[i].name = key;
+  reflection->lookup[i].index = index;
+  reflection->lookupCount++;
 }
 
-void Shader_free(Shader_T sh) {
-  free(sh);
+/* doubles the table; keys move, the strings are kept */
+void growLookup(struct ProgramReflection* reflection)
+{
+  unsigned int capacity = reflection->lookupCapacity * 2;
+  struct UniformEntry* lookup = (struct UniformEntry*)calloc(capacity, sizeof(struct UniformEntry));
+  if (lookup == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (unsigned int j = 0; j < reflection->lookupCapacity; j++)
+  {
+    if (reflection->lookup[j].name == NULL)
+      continue;
+    unsigned int i = hashUniformName(reflection->lookup[j].name) & (capacity - 1);
+    while (lookup[i].name != NULL)
+      i = (i + 1) & (capacity - 1);
+    lookup[i] = reflection->lookup[j];
+  }
+  free(reflection->lookup);
+  reflection->lookup = lookup;
+  reflection->lookupCapacity = capacity;
 }
 
-void Shader_use(Shader_T sh) {
-  glUseProgram(sh->ID);
+/* ask the driver once after link so the setters never have to */
+void reflectProgram(Shader_T sh)
+{
+  memset(&sh->reflection, 0, sizeof(sh->reflection));
+  reflectUniforms(sh->ID, &sh->reflection);
+  /* a program that never got its sources has nothing else to report */
+  if (sh->ID != 0)
+  {
+    reflectAttributes(sh->ID, &sh->reflection);
+    reflectBlocks(sh->ID, &sh->reflection);
+  }
+  for (int i = 0; i < sh->handleCount; i++)
+    sh->handles[i].index = resolveUniform(sh, sh->handles[i].name);
 }
 
-void Shader_setBool(Shader_T sh, const char* name, bool value)
+void reflectUniforms(unsigned int program, struct ProgramReflection* reflection)
+{
+  int count = 0;
+  int maxLength = 0;
+  if (program != 0)
+  {
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  }
+
+  /* arrays are stored under both "name" and "name[0]", keep load <= 1/2 */
+  reflection->lookupCapacity = 8;
+  while (reflection->lookupCapacity < (unsigned int)count * 4)
+    reflection->lookupCapacity *= 2;
+  reflection->lookup =
+    (struct UniformEntry*)calloc(reflection->lookupCapacity, sizeof(struct UniformEntry));
+  reflection->uniforms =
+    (struct UniformInfo*)calloc(count > 0 ? count : 1, sizeof(struct UniformInfo));
+  GLuint* indices = (GLuint*)malloc((count > 0 ? count : 1) * sizeof(GLuint));
+  GLint* blocks = (GLint*)malloc((count > 0 ? count : 1) * sizeof(GLint));
+  char* name = (char*)malloc(maxLength > 0 ? maxLength : 1);
+  if (reflection->lookup == NULL || reflection->uniforms == NULL ||
+      indices == NULL || blocks == NULL || name == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  reflection->uniformCount = count;
+
+  /* block membership for every uniform in one query */
+  for (int i = 0; i < count; i++)
+    indices[i] = (GLuint)i;
+  if (count > 0)
+    glGetActiveUniformsiv(program, count, indices, GL_UNIFORM_BLOCK_INDEX, blocks);
+
+  for (int i = 0; i < count; i++)
+  {
+    struct UniformInfo* uniform = &reflection->uniforms[i];
+    GLsizei length = 0;
+    glGetActiveUniform(program, (GLuint)i, maxLength, &length, &uniform->size,
+                       &uniform->type, name);
+    uniform->name = copyString(name);
+    uniform->block = blocks[i];
+    /* uniforms inside blocks have no location */
+    uniform->location = uniform->block == -1 ? glGetUniformLocation(program, name) : -1;
+    insertUniform(reflection, name, (size_t)length, i);
+    if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+      insertUniform(reflection, name, (size_t)length - 3, i);
+  }
+  free(name);
+  free(blocks);
+  free(indices);
+}
+
+void reflectAttributes(unsigned int program, struct ProgramReflection* reflection)
 {
-  glUniform1i(glGetUniformLocation(sh->ID, name), (int)value);
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+  reflection->attributes =
+    (struct AttributeInfo*)calloc(count > 0 ? count : 1, sizeof(struct AttributeInfo));
+  char* name = (char*)malloc(maxLength > 0 ? maxLength : 1);
+  if (reflection->attributes == NULL || name == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  reflection->attributeCount = count;
+
+  for (int i = 0; i < count; i++)
+  {
+    struct AttributeInfo* attribute = &reflection->attributes[i];
+    glGetActiveAttrib(program, (GLuint)i, maxLength, NULL, &attribute->size,
+                      &attribute->type, name);
+    attribute->name = copyString(name);
+    attribute->location = glGetAttribLocation(program, name);
+  }
+  free(name);
 }
 
-void Shader_setInt(Shader_T sh, const char* name, int value)
+void reflectBlocks(unsigned int program, struct ProgramReflection* reflection)
 {
-  glUniform1i(glGetUniformLocation(sh->ID, name), value);
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+
+  reflection->blocks = (struct BlockInfo*)calloc(count > 0 ? count : 1, sizeof(struct BlockInfo));
+  char* name = (char*)malloc(maxLength > 0 ? maxLength : 1);
+  if (reflection->blocks == NULL || name == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  reflection->blockCount = count;
+
+  for (int i = 0; i < count; i++)
+  {
+    struct BlockInfo* block = &reflection->blocks[i];
+    glGetActiveUniformBlockName(program, (GLuint)i, maxLength, NULL, name);
+    block->name = copyString(name);
+    block->index = (unsigned int)i;
+    glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &block->dataSize);
+    glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS,
+                              &block->memberCount);
+  }
+  free(name);
 }
 
-void Shader_setFloat(Shader_T sh, const char* name, float value)
+void freeReflection(struct ProgramReflection* reflection)
 {
-  glUniform1f(glGetUniformLocation(sh->ID, name), value);
+  for (unsigned int i = 0; i < reflection->lookupCapacity; i++)
+    free(reflection->lookup[i].name);
+  for (int i = 0; i < reflection->uniformCount; i++)
+    free(reflection->uniforms[i].name);
+  for (int i = 0; i < reflection->attributeCount; i++)
+    free(reflection->attributes[i].name);
+  for (int i = 0; i < reflection->blockCount; i++)
+    free(reflection->blocks[i].name);
+  free(reflection->lookup);
+  free(reflection->uniforms);
+  free(reflection->attributes);
+  free(reflection->blocks);
+  memset(reflection, 0, sizeof(*reflection));
 }
 
-/* utility functions */
-/* --------------------------------------------------------------- */
-void getFileLength(FILE* file, long* length)
+void applyBlockBindings(Shader_T sh)
 {
-  fseek(file, 0, SEEK_END);
-  *length = ftell(file);
-  rewind(file);
+  for (int i = 0; i < sh->blockCount; i++)
+  {
+    int block = findBlock(&sh->reflection, sh->blocks[i].name);
+    if (block != -1)
+      glUniformBlockBinding(sh->ID, sh->reflection.blocks[block].index, sh->blocks[i].binding);
+  }
+}
+
+/* index into the reflected uniforms, -1 if the program has no such uniform */
+int findUniform(const struct ProgramReflection* reflection, const char* name)
+{
+  unsigned int mask = reflection->lookupCapacity - 1;
+  unsigned int i = hashUniformName(name) & mask;
+  while (reflection->lookup[i].name != NULL)
+  {
+    if (strcmp(reflection->lookup[i].name, name) == 0)
+      return reflection->lookup[i].index;
+    i = (i + 1) & mask;
+  }
+  return -1;
+}
+
+/**
+ * findUniform, except that an element of an array by name ("lights[2]")
+ * gets an entry of its own the first time, located once by the driver.
+ * Only names whose array is active and long enough reach the driver.
+*/
+int resolveUniform(Shader_T sh, const char* name)
+{
+  struct ProgramReflection* reflection = &sh->reflection;
+  int index = findUniform(reflection, name);
+  if (index != -1)
+    return index;
+
+  size_t length = strlen(name);
+  const char* open = strrchr(name, '[');
+  if (open == NULL || open == name || name[length - 1] != ']')
+    return -1;
+  char* end;
+  long element = strtol(open + 1, &end, 10);
+  if (end == open + 1 || end != name + length - 1 || element <= 0)
+    return -1;
+
+  char* arrayName = (char*)malloc((size_t)(open - name) + 1);
+  if (arrayName == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(arrayName, name, (size_t)(open - name));
+  arrayName[open - name] = '\0';
+  int arrayIndex = findUniform(reflection, arrayName);
+  free(arrayName);
+  if (arrayIndex == -1 || reflection->uniforms[arrayIndex].location == -1 ||
+      element >= reflection->uniforms[arrayIndex].size)
+    return -1;
+  int location = glGetUniformLocation(sh->ID, name);
+  if (location == -1)
+    return -1;
+
+  struct UniformInfo* uniforms = (struct UniformInfo*)realloc(
+    reflection->uniforms, (reflection->uniformCount + 1) * sizeof(struct UniformInfo));
+  if (uniforms == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  reflection->uniforms = uniforms;
+  index = reflection->uniformCount++;
+  struct UniformInfo* uniform = &uniforms[index];
+  memset(uniform, 0, sizeof(*uniform));
+  uniform->name = copyString(name);
+  uniform->type = uniforms[arrayIndex].type;
+  uniform->size = 1;
+  uniform->location = location;
+  uniform->block = -1;
+  uniform->element = true;
+  insertUniform(reflection, name, length, index);
+  return index;
+}
+
+int findBlock(const struct ProgramReflection* reflection, const char* name)
+{
+  for (int i = 0; i < reflection->blockCount; i++)
+    if (strcmp(reflection->blocks[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+/* glUniform1i sets bools, ints and samplers; glUniform1f only floats here */
+bool checkUniformType(struct UniformInfo* uniform, GLenum setterType)
+{
+  bool matches;
+  if (uniform->type == GL_BOOL) /* glUniform1i and glUniform1f both set a bool */
+    matches = setterType == GL_BOOL || setterType == GL_INT || setterType == GL_FLOAT;
+  else if (uniform->type == GL_INT || isSamplerType(uniform->type))
+    matches = setterType == GL_BOOL || setterType == GL_INT;
+  else
+    matches = uniform->type == setterType;
+  /* once per uniform, the setter is usually called every frame */
+  if (!matches && !uniform->typeReported)
+  {
+    printf("ERROR::SHADER uniform %s is a %s, set as a %s\n", uniform->name,
+           glslTypeName(uniform->type), glslTypeName(setterType));
+    uniform->typeReported = true;
+  }
+  return matches;
+}
+
+/* samplers and images of every kind; each takes a texture unit through glUniform1i */
+bool isSamplerType(GLenum type)
+{
+  return (type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW) ||
+         (type >= GL_SAMPLER_1D_ARRAY && type <= GL_SAMPLER_CUBE_SHADOW) ||
+         (type >= GL_INT_SAMPLER_1D && type <= GL_UNSIGNED_INT_SAMPLER_BUFFER) ||
+         (type >= GL_SAMPLER_2D_MULTISAMPLE && type <= GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY) ||
+         (type >= 0x900C && type <= 0x900F) || /* cube map arrays, GL 4.0 */
+         (type >= 0x904C && type <= 0x906C);   /* images, GL 4.2 */
+}
+
+const char* glslTypeName(GLenum type)
+{
+  switch (type)
+  {
+  case GL_FLOAT: return "float";
+  case GL_FLOAT_VEC2: return "vec2";
+  case GL_FLOAT_VEC3: return "vec3";
+  case GL_FLOAT_VEC4: return "vec4";
+  case GL_INT: return "int";
+  case GL_INT_VEC2: return "ivec2";
+  case GL_INT_VEC3: return "ivec3";
+  case GL_INT_VEC4: return "ivec4";
+  case GL_UNSIGNED_INT: return "uint";
+  case GL_BOOL: return "bool";
+  case GL_FLOAT_MAT2: return "mat2";
+  case GL_FLOAT_MAT3: return "mat3";
+  case GL_FLOAT_MAT4: return "mat4";
+  case GL_SAMPLER_2D: return "sampler2D";
+  case GL_SAMPLER_3D: return "sampler3D";
+  case GL_SAMPLER_CUBE: return "samplerCube";
+  case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
+  case GL_SAMPLER_2D_SHADOW: return "sampler2DShadow";
+  default: return isSamplerType(type) ? "sampler" : "other";
+  }
+}
+
+void setUniformInt(Shader_T sh, int index, GLenum setterType, int value)
+{
+  if (index == -1)
+    return;
+  struct UniformInfo* uniform = &sh->reflection.uniforms[index];
+  if (uniform->location != -1 && checkUniformType(uniform, setterType) &&
+      shadowUniform(uniform, GL_INT, &value, sizeof(value)))
+    glUniform1i(uniform->location, value);
+}
+
+void setUniformFloat(Shader_T sh, int index, float value)
+{
+  if (index == -1)
+    return;
+  struct UniformInfo* uniform = &sh->reflection.uniforms[index];
+  if (uniform->location != -1 && checkUniformType(uniform, GL_FLOAT) &&
+      shadowUniform(uniform, GL_FLOAT, &value, sizeof(value)))
+    glUniform1f(uniform->location, value);
+}
+
+/* records the value; false means it is already current and the call can go */
+bool shadowUniform(struct UniformInfo* uniform, GLenum type,
+                   const void* value, size_t size)
+{
+  struct UniformValue* current = &uniform->value;
+  if (current->type == type && memcmp(current->data, value, size) == 0)
+  {
+    uniformStats.skipped++;
+    return false;
+  }
+  current->type = type;
+  memcpy(current->data, value, size);
+  uniform->changes++;
+  uniformStats.issued++;
+  return true;
+}
+
+/* re-issues a shadowed value on whatever program is bound */
+void uploadUniform(int location, const struct UniformValue* value)
+{
+  switch (value->type)
+  {
+  case GL_INT:
+    glUniform1i(location, *(const int*)value->data);
+    break;
+  case GL_FLOAT:
+    glUniform1f(location, *(const float*)value->data);
+    break;
+  default:
+    break;
+  }
+}
+
+/* copies values set on a replaced program onto sh (bound) by name */
+void restoreUniforms(Shader_T sh, const struct ProgramReflection* old)
+{
+  for (int i = 0; i < old->uniformCount; i++)
+  {
+    const struct UniformValue* value = &old->uniforms[i].value;
+    if (value->type == GL_NONE)
+      continue;
+    int index = resolveUniform(sh, old->uniforms[i].name);
+    if (index == -1)
+      continue;
+    struct UniformInfo* uniform = &sh->reflection.uniforms[index];
+    if (uniform->location != -1)
+    {
+      uniform->value = *value;
+      uploadUniform(uniform->location, value);
+    }
+  }
 }
 
-void checkCompileErrors(unsigned int shader, const char* type)
+bool checkCompileErrors(unsigned int shader, const char* type)
 {
   int success;
   char infoLog[1024];
-  if (type != "PROGRAM")
+  if (strcmp(type, "PROGRAM") != 0)
   {
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success)
@@ -165,6 +1593,7 @@ void checkCompileErrors(unsigned int shader, const char* type)
       printf("%s\n", infoLog);
     }
   } 
+  return success != 0;
 }
 
 #endif
\ No newline at end of file
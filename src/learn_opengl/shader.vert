@@ -1,11 +1,14 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
 layout (location = 1) in vec3 aColor; // the color variable has attribute position 1
+
+// shared by every program, uploaded once per frame (see FRAME_DATA_FIELDS)
+#include "frame_data.glsl"
   
 out vec3 ourColor; // output a color to the fragment shader
 
 void main()
 {
-    gl_Position = vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(aPos, 1.0);
     ourColor = aColor; // set ourColor to the input color we got from the vertex data
 }   
\ No newline at end of file
@@ -0,0 +1,638 @@
+#ifndef SHADER_INCLUDE_H
+#define SHADER_INCLUDE_H
+
+/**
+ * Shader Include
+ * --------------
+ * Resolves `#include "file"` lines before the source reaches
+ * glShaderSource. Paths are relative to the including file, and every
+ * file is pasted at most once per expansion. `#line` directives keep
+ * driver errors pointing at the right place: source string 0 is the root
+ * file and N is include node N - 1.
+ *
+ * Every file seen is a node in a dependency graph, remembered by path with
+ * its content hash, its text and its includes; the expansion pastes the
+ * very text that was hashed. Each root keeps one expanded source, cached
+ * under a key built from the content hashes of every file that went into
+ * it, so a root whose headers did not change is never expanded twice and
+ * an edit replaces the entry instead of adding one. A root without
+ * includes is passed through still mapped, without a copy.
+ *
+ * Lines inside block comments and `#if 0` regions are never includes.
+ *
+ * ShaderInclude_define registers generated text under a bare name, e.g. a
+ * uniform block from std140_block.h. Such a name is found before any file,
+ * whatever directory the includer is in.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "program_cache.h"
+#include "shader_source.h"
+
+#define SHADER_INCLUDE_PATH_MAX 512
+#define SHADER_INCLUDE_DEPTH_MAX 32
+
+typedef void (*ShaderIncludeVisitor)(const char* path, void* user);
+
+bool ShaderInclude_load(const char* path, struct ShaderSource* source);
+int ShaderInclude_loadMany(const char** paths, int count, struct ShaderSource* sources);
+void ShaderInclude_expand(const char* name, struct ShaderSource* source);
+void ShaderInclude_define(const char* name, const char* text);
+void ShaderInclude_forEachDependency(const char* path, ShaderIncludeVisitor visit, void* user);
+void ShaderInclude_invalidate(const char* path);
+void ShaderInclude_printStats(void);
+/* utility functions */
+static int findIncludeNode(const char* path);
+static int findDefinedNode(const char* name);
+static int addIncludeNode(const char* path);
+static void scanIncludes(int node, const char* code, size_t length, int depth);
+static int refreshIncludeNode(const char* path, int depth);
+static bool parseIncludeLine(const char* line, size_t length, char* name);
+struct IncludeScan;
+static bool includeLineLive(struct IncludeScan* scan, const char* line, size_t length);
+static void expandRoot(const char* name, struct ShaderSource* source);
+static void freeRetired(void);
+static void resolveIncludePath(const char* includer, const char* name, char* path);
+static uint64_t expansionKey(int node, uint64_t key, unsigned int mark);
+static void expandNode(int node, const char* code, size_t length, unsigned int mark, int depth);
+static void appendExpanded(const char* text, size_t length);
+static void visitDependencies(int node, ShaderIncludeVisitor visit, void* user, unsigned int mark);
+
+struct IncludeNode {
+  char* path;
+  char* text; /* set for ShaderInclude_define names, which have no file */
+  GLint textLength;
+  char* content; /* a file's text as last read and hashed */
+  GLint contentLength;
+  uint64_t hash; /* of the file contents */
+  long long size;
+  long long mtime; /* -1 forces a re-read */
+  int* children; /* one entry per include line, in order; -1 if unresolved */
+  int childCount;
+  unsigned int mark; /* per-traversal visited flag */
+  unsigned int refreshed; /* last refresh pass that checked this node */
+};
+
+struct ExpandedSource {
+  int root; /* node of the file expanded, one entry each */
+  uint64_t key;
+  char* code;
+  GLint length;
+};
+
+/* where a line-by-line walk is: in a block comment, or in an #if 0 region */
+struct IncludeScan {
+  bool inComment;
+  int disabledDepth; /* conditionals open since the #if 0, 0 when live */
+};
+
+static struct {
+  struct IncludeNode* nodes;
+  int nodeCount;
+  int nodeCapacity;
+  struct ExpandedSource* expanded;
+  int expandedCount;
+  int expandedCapacity;
+  /* replaced expansions, freed at the start of the next call */
+  char** retired;
+  int retiredCount;
+  int retiredCapacity;
+  unsigned int mark;
+  unsigned int refreshPass;
+  /* scratch buffer for the expansion in progress */
+  char* buffer;
+  size_t bufferLength;
+  size_t bufferCapacity;
+  unsigned int hits;
+  unsigned int misses;
+} shaderIncludes;
+
+bool ShaderInclude_load(const char* path, struct ShaderSource* source)
+{
+  return ShaderInclude_loadMany(&path, 1, source) == 1;
+}
+
+/**
+ * Maps every root file in one pass, then expands the ones that include
+ * anything. Expanded sources are owned by the cache (SHADER_SOURCE_STATIC).
+ * One stays valid until its root is loaded again after an edit; even then
+ * the old text is only freed by the call after that one. Returns how many
+ * loaded.
+*/
+int ShaderInclude_loadMany(const char** paths, int count, struct ShaderSource* sources)
+{
+  freeRetired();
+  int loaded = ShaderSource_mapMany(paths, count, sources);
+  for (int i = 0; i < count; i++)
+    if (sources[i].storage != SHADER_SOURCE_NONE)
+      expandRoot(paths[i], &sources[i]);
+  return loaded;
+}
+
+/**
+ * Expands a source that is already in memory, e.g. one embedded in the
+ * executable. name stands in for its path: it resolves relative includes
+ * and keys the cache. The source is replaced only if it includes anything.
+*/
+void ShaderInclude_expand(const char* name, struct ShaderSource* source)
+{
+  freeRetired();
+  expandRoot(name, source);
+}
+
+/* text is copied; defining a name again replaces it for later loads */
+void ShaderInclude_define(const char* name, const char* text)
+{
+  int node = findIncludeNode(name);
+  if (node == -1)
+    node = addIncludeNode(name);
+  size_t length = strlen(text);
+  char* copy = (char*)malloc(length + 1);
+  if (copy == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(copy, text, length + 1);
+  free(shaderIncludes.nodes[node].text);
+  shaderIncludes.nodes[node].text = copy;
+  shaderIncludes.nodes[node].textLength = (GLint)length;
+  shaderIncludes.nodes[node].hash = hashBytes64(14695981039346656037ull, copy, length);
+  shaderIncludes.nodes[node].size = (long long)length;
+  shaderIncludes.nodes[node].refreshed = ++shaderIncludes.refreshPass;
+  scanIncludes(node, copy, length, 0);
+}
+
+/* visits the file itself and everything it includes, each once */
+void ShaderInclude_forEachDependency(const char* path, ShaderIncludeVisitor visit, void* user)
+{
+  int node = findIncludeNode(path);
+  if (node == -1)
+  {
+    visit(path, user);
+    return;
+  }
+  visitDependencies(node, visit, user, ++shaderIncludes.mark);
+}
+
+/* force the next load to re-read the file, e.g. after a change event */
+void ShaderInclude_invalidate(const char* path)
+{
+  int node = findIncludeNode(path);
+  if (node != -1)
+    shaderIncludes.nodes[node].mtime = -1;
+}
+
+void ShaderInclude_printStats(void)
+{
+  printf("include cache: %u hits, %u misses, %d files\n",
+         shaderIncludes.hits, shaderIncludes.misses, shaderIncludes.nodeCount);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* ShaderInclude_expand without freeing what earlier calls replaced */
+void expandRoot(const char* name, struct ShaderSource* source)
+{
+  int root = findIncludeNode(name);
+  if (root == -1)
+    root = addIncludeNode(name);
+  struct IncludeNode* node = &shaderIncludes.nodes[root];
+  node->refreshed = ++shaderIncludes.refreshPass;
+  node->hash = hashBytes64(14695981039346656037ull, source->code, (size_t)source->length);
+  node->size = source->length;
+  scanIncludes(root, source->code, (size_t)source->length, 0);
+  if (shaderIncludes.nodes[root].childCount == 0)
+    return;
+
+  uint64_t key = expansionKey(root, 14695981039346656037ull, ++shaderIncludes.mark);
+  int found = -1, previous = -1;
+  for (int j = 0; j < shaderIncludes.expandedCount && found == -1; j++)
+  {
+    if (shaderIncludes.expanded[j].key == key)
+      found = j;
+    else if (shaderIncludes.expanded[j].root == root)
+      previous = j;
+  }
+
+  if (found == -1)
+  {
+    shaderIncludes.bufferLength = 0;
+    shaderIncludes.nodes[root].mark = ++shaderIncludes.mark;
+    expandNode(root, source->code, (size_t)source->length, shaderIncludes.mark, 0);
+
+    if (previous != -1)
+    {
+      /* the root was edited; sources handed out this call may still use it */
+      if (shaderIncludes.retiredCount == shaderIncludes.retiredCapacity)
+      {
+        int capacity = shaderIncludes.retiredCapacity ? shaderIncludes.retiredCapacity * 2 : 8;
+        char** retired = (char**)realloc(shaderIncludes.retired, capacity * sizeof(char*));
+        if (retired == NULL)
+        {
+          printf("Memory not allocated.\n");
+          exit(EXIT_FAILURE);
+        }
+        shaderIncludes.retired = retired;
+        shaderIncludes.retiredCapacity = capacity;
+      }
+      shaderIncludes.retired[shaderIncludes.retiredCount++] = shaderIncludes.expanded[previous].code;
+    }
+    else if (shaderIncludes.expandedCount == shaderIncludes.expandedCapacity)
+    {
+      int capacity = shaderIncludes.expandedCapacity ? shaderIncludes.expandedCapacity * 2 : 16;
+      struct ExpandedSource* expanded = (struct ExpandedSource*)realloc(
+        shaderIncludes.expanded, capacity * sizeof(struct ExpandedSource));
+      if (expanded == NULL)
+      {
+        printf("Memory not allocated.\n");
+        exit(EXIT_FAILURE);
+      }
+      shaderIncludes.expanded = expanded;
+      shaderIncludes.expandedCapacity = capacity;
+    }
+    found = previous != -1 ? previous : shaderIncludes.expandedCount++;
+    struct ExpandedSource* entry = &shaderIncludes.expanded[found];
+    entry->root = root;
+    entry->key = key;
+    entry->length = (GLint)shaderIncludes.bufferLength;
+    entry->code = (char*)malloc(shaderIncludes.bufferLength ? shaderIncludes.bufferLength : 1);
+    if (entry->code == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(entry->code, shaderIncludes.buffer, shaderIncludes.bufferLength);
+    shaderIncludes.misses++;
+  }
+  else
+    shaderIncludes.hits++;
+
+  ShaderSource_release(source);
+  source->code = shaderIncludes.expanded[found].code;
+  source->length = shaderIncludes.expanded[found].length;
+  source->storage = SHADER_SOURCE_STATIC;
+}
+
+void freeRetired(void)
+{
+  for (int i = 0; i < shaderIncludes.retiredCount; i++)
+    free(shaderIncludes.retired[i]);
+  shaderIncludes.retiredCount = 0;
+}
+
+int findIncludeNode(const char* path)
+{
+  for (int i = 0; i < shaderIncludes.nodeCount; i++)
+    if (strcmp(shaderIncludes.nodes[i].path, path) == 0)
+      return i;
+  return -1;
+}
+
+int findDefinedNode(const char* name)
+{
+  int node = findIncludeNode(name);
+  return node != -1 && shaderIncludes.nodes[node].text ? node : -1;
+}
+
+int addIncludeNode(const char* path)
+{
+  if (shaderIncludes.nodeCount == shaderIncludes.nodeCapacity)
+  {
+    int capacity = shaderIncludes.nodeCapacity ? shaderIncludes.nodeCapacity * 2 : 16;
+    struct IncludeNode* nodes =
+      (struct IncludeNode*)realloc(shaderIncludes.nodes, capacity * sizeof(struct IncludeNode));
+    if (nodes == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderIncludes.nodes = nodes;
+    shaderIncludes.nodeCapacity = capacity;
+  }
+  struct IncludeNode* node = &shaderIncludes.nodes[shaderIncludes.nodeCount];
+  memset(node, 0, sizeof(*node));
+  node->path = (char*)malloc(strlen(path) + 1);
+  if (node->path == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(node->path, path);
+  node->mtime = -1;
+  return shaderIncludes.nodeCount++;
+}
+
+/* rebuild the node's edge list from its text, refreshing each include */
+void scanIncludes(int node, const char* code, size_t length, int depth)
+{
+  char name[SHADER_INCLUDE_PATH_MAX];
+  char path[SHADER_INCLUDE_PATH_MAX];
+  int childCount = 0;
+  int* children = NULL;
+  struct IncludeScan scan = { false, 0 };
+
+  for (size_t start = 0; start < length; )
+  {
+    const char* end = (const char*)memchr(code + start, '\n', length - start);
+    size_t lineLength = end ? (size_t)(end - (code + start)) : length - start;
+    if (includeLineLive(&scan, code + start, lineLength) &&
+        parseIncludeLine(code + start, lineLength, name))
+    {
+      int* grown = (int*)realloc(children, (childCount + 1) * sizeof(int));
+      if (grown == NULL)
+      {
+        printf("Memory not allocated.\n");
+        exit(EXIT_FAILURE);
+      }
+      children = grown;
+      int child = findDefinedNode(name);
+      if (child == -1)
+      {
+        /* nodes may move while refreshing, so look the includer up each time */
+        resolveIncludePath(shaderIncludes.nodes[node].path, name, path);
+        child = refreshIncludeNode(path, depth + 1);
+      }
+      children[childCount++] = child;
+    }
+    start += lineLength + 1;
+  }
+
+  free(shaderIncludes.nodes[node].children);
+  shaderIncludes.nodes[node].children = children;
+  shaderIncludes.nodes[node].childCount = childCount;
+}
+
+/* returns the node for an included file, re-reading it only if it changed */
+int refreshIncludeNode(const char* path, int depth)
+{
+  struct stat info;
+  int defined = findDefinedNode(path);
+  if (defined != -1)
+    return defined;
+  if (depth > SHADER_INCLUDE_DEPTH_MAX)
+  {
+    printf("ERROR::SHADER_INCLUDE nesting too deep at %s\n", path);
+    return -1;
+  }
+  if (stat(path, &info) != 0)
+  {
+    printf("ERROR::SHADER_INCLUDE cannot find %s\n", path);
+    return -1;
+  }
+
+  int node = findIncludeNode(path);
+  if (node == -1)
+    node = addIncludeNode(path);
+  /* already checked during this load; also stops include cycles */
+  if (shaderIncludes.nodes[node].refreshed == shaderIncludes.refreshPass)
+    return node;
+  shaderIncludes.nodes[node].refreshed = shaderIncludes.refreshPass;
+  if (shaderIncludes.nodes[node].mtime == (long long)info.st_mtime &&
+      shaderIncludes.nodes[node].size == (long long)info.st_size)
+  {
+    /* unchanged, but something further down may have been edited */
+    for (int i = 0; i < shaderIncludes.nodes[node].childCount; i++)
+    {
+      int child = shaderIncludes.nodes[node].children[i];
+      if (child != -1)
+      {
+        /* the node array may grow during the call */
+        child = refreshIncludeNode(shaderIncludes.nodes[child].path, depth + 1);
+        shaderIncludes.nodes[node].children[i] = child;
+      }
+    }
+    return node;
+  }
+
+  /* kept, so the expansion pastes exactly the text hashed here */
+  struct ShaderSource source;
+  if (!ShaderSource_map(path, &source))
+    return -1;
+  char* content = (char*)malloc(source.length > 0 ? (size_t)source.length : 1);
+  if (content == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(content, source.code, (size_t)source.length);
+  free(shaderIncludes.nodes[node].content);
+  shaderIncludes.nodes[node].content = content;
+  shaderIncludes.nodes[node].contentLength = source.length;
+  ShaderSource_release(&source);
+  shaderIncludes.nodes[node].hash =
+    hashBytes64(14695981039346656037ull, content, (size_t)shaderIncludes.nodes[node].contentLength);
+  shaderIncludes.nodes[node].size = (long long)info.st_size;
+  shaderIncludes.nodes[node].mtime = (long long)info.st_mtime;
+  scanIncludes(node, content, (size_t)shaderIncludes.nodes[node].contentLength, depth);
+  return node;
+}
+
+/* matches `#include "name"` or `#include <name>` with optional blanks */
+bool parseIncludeLine(const char* line, size_t length, char* name)
+{
+  size_t i = 0;
+  while (i < length && (line[i] == ' ' || line[i] == '\t'))
+    i++;
+  if (i == length || line[i++] != '#')
+    return false;
+  while (i < length && (line[i] == ' ' || line[i] == '\t'))
+    i++;
+  if (length - i < 7 || strncmp(line + i, "include", 7) != 0)
+    return false;
+  i += 7;
+  while (i < length && (line[i] == ' ' || line[i] == '\t'))
+    i++;
+  if (i == length || (line[i] != '"' && line[i] != '<'))
+    return false;
+
+  char close = line[i] == '"' ? '"' : '>';
+  size_t start = ++i;
+  while (i < length && line[i] != close)
+    i++;
+  if (i == length || i == start || i - start >= SHADER_INCLUDE_PATH_MAX)
+    return false;
+  memcpy(name, line + start, i - start);
+  name[i - start] = '\0';
+  return true;
+}
+
+/**
+ * Whether a directive on this line is seen by the preprocessor: it doesn't
+ * start inside a block comment or an #if 0 region. Call for every line in
+ * order; the scan follows comments and the conditionals nested in #if 0.
+*/
+bool includeLineLive(struct IncludeScan* scan, const char* line, size_t length)
+{
+  bool live = false;
+  if (!scan->inComment)
+  {
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t'))
+      i++;
+    bool directive = i < length && line[i] == '#';
+    if (directive)
+    {
+      i++;
+      while (i < length && (line[i] == ' ' || line[i] == '\t'))
+        i++;
+    }
+    size_t word = i;
+    while (i < length && line[i] >= 'a' && line[i] <= 'z')
+      i++;
+    size_t wordLength = i - word;
+    while (i < length && (line[i] == ' ' || line[i] == '\t'))
+      i++;
+
+    if (directive && scan->disabledDepth > 0)
+    {
+      if (wordLength >= 2 && strncmp(line + word, "if", 2) == 0)
+        scan->disabledDepth++;
+      else if (wordLength == 5 && strncmp(line + word, "endif", 5) == 0)
+        scan->disabledDepth--;
+      else if (scan->disabledDepth == 1 && wordLength == 4 &&
+               (strncmp(line + word, "else", 4) == 0 || strncmp(line + word, "elif", 4) == 0))
+        scan->disabledDepth = 0;
+    }
+    else if (directive && wordLength == 2 && strncmp(line + word, "if", 2) == 0 &&
+             i < length && line[i] == '0' &&
+             (i + 1 == length || line[i + 1] == ' ' || line[i + 1] == '\t' ||
+              line[i + 1] == '\r' || line[i + 1] == '/'))
+      scan->disabledDepth = 1;
+    else
+      live = scan->disabledDepth == 0;
+  }
+
+  for (size_t i = 0; i + 1 < length; i++)
+  {
+    if (scan->inComment && line[i] == '*' && line[i + 1] == '/')
+    {
+      scan->inComment = false;
+      i++;
+    }
+    else if (!scan->inComment && line[i] == '/' && line[i + 1] == '/')
+      break;
+    else if (!scan->inComment && line[i] == '/' && line[i + 1] == '*')
+    {
+      scan->inComment = true;
+      i++;
+    }
+  }
+  return live;
+}
+
+void resolveIncludePath(const char* includer, const char* name, char* path)
+{
+  const char* slash = strrchr(includer, '/');
+  if (slash == NULL || name[0] == '/')
+    snprintf(path, SHADER_INCLUDE_PATH_MAX, "%s", name);
+  else
+    snprintf(path, SHADER_INCLUDE_PATH_MAX, "%.*s/%s", (int)(slash - includer), includer, name);
+}
+
+/* content hashes of every file pasted in, in expansion order */
+uint64_t expansionKey(int node, uint64_t key, unsigned int mark)
+{
+  shaderIncludes.nodes[node].mark = mark;
+  key = hashBytes64(key, &shaderIncludes.nodes[node].hash, sizeof(uint64_t));
+  /* the node index ends up in the #line directives */
+  key = hashBytes64(key, &node, sizeof(node));
+  for (int i = 0; i < shaderIncludes.nodes[node].childCount; i++)
+  {
+    int child = shaderIncludes.nodes[node].children[i];
+    if (child != -1 && shaderIncludes.nodes[child].mark != mark)
+      key = expansionKey(child, key, mark);
+  }
+  return key;
+}
+
+void expandNode(int node, const char* code, size_t length, unsigned int mark, int depth)
+{
+  char directive[64];
+  int include = 0;
+  int line = 1;
+  int sourceNumber = depth == 0 ? 0 : node + 1;
+  struct IncludeScan scan = { false, 0 };
+
+  for (size_t start = 0; start < length; line++)
+  {
+    const char* end = (const char*)memchr(code + start, '\n', length - start);
+    size_t lineLength = end ? (size_t)(end - (code + start)) : length - start;
+    char name[SHADER_INCLUDE_PATH_MAX];
+    int child = -1;
+
+    /* the same walk as scanIncludes, so the n-th include is children[n] */
+    if (includeLineLive(&scan, code + start, lineLength) &&
+        parseIncludeLine(code + start, lineLength, name) &&
+        include < shaderIncludes.nodes[node].childCount)
+      child = shaderIncludes.nodes[node].children[include++];
+    else
+      name[0] = '\0';
+
+    if (name[0] == '\0' || child == -1)
+    {
+      /* ordinary line, or an include that could not be resolved */
+      appendExpanded(code + start, lineLength);
+      appendExpanded("\n", 1);
+    }
+    else if (shaderIncludes.nodes[child].mark == mark)
+      appendExpanded("\n", 1); /* already pasted; keep the line count */
+    else
+    {
+      const struct IncludeNode* included = &shaderIncludes.nodes[child];
+      const char* text = included->text ? included->text : included->content;
+      GLint textLength = included->text ? included->textLength : included->contentLength;
+      shaderIncludes.nodes[child].mark = mark;
+      if (text)
+      {
+        snprintf(directive, sizeof(directive), "#line 1 %d\n", child + 1);
+        appendExpanded(directive, strlen(directive));
+        expandNode(child, text, (size_t)textLength, mark, depth + 1);
+      }
+      snprintf(directive, sizeof(directive), "#line %d %d\n", line + 1, sourceNumber);
+      appendExpanded(directive, strlen(directive));
+    }
+    start += lineLength + 1;
+  }
+}
+
+void appendExpanded(const char* text, size_t length)
+{
+  if (shaderIncludes.bufferLength + length > shaderIncludes.bufferCapacity)
+  {
+    size_t capacity = shaderIncludes.bufferCapacity ? shaderIncludes.bufferCapacity : 4096;
+    while (capacity < shaderIncludes.bufferLength + length)
+      capacity *= 2;
+    char* buffer = (char*)realloc(shaderIncludes.buffer, capacity);
+    if (buffer == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderIncludes.buffer = buffer;
+    shaderIncludes.bufferCapacity = capacity;
+  }
+  memcpy(shaderIncludes.buffer + shaderIncludes.bufferLength, text, length);
+  shaderIncludes.bufferLength += length;
+}
+
+void visitDependencies(int node, ShaderIncludeVisitor visit, void* user, unsigned int mark)
+{
+  shaderIncludes.nodes[node].mark = mark;
+  if (shaderIncludes.nodes[node].text == NULL)
+    visit(shaderIncludes.nodes[node].path, user);
+  for (int i = 0; i < shaderIncludes.nodes[node].childCount; i++)
+  {
+    int child = shaderIncludes.nodes[node].children[i];
+    if (child != -1 && shaderIncludes.nodes[child].mark != mark)
+      visitDependencies(child, visit, user, mark);
+  }
+}
+
+#endif
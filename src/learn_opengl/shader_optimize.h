@@ -0,0 +1,788 @@
+#ifndef SHADER_OPTIMIZE_H
+#define SHADER_OPTIMIZE_H
+
+/**
+ * Shader Optimize
+ * ---------------
+ * Optional clean-up of GLSL text before it reaches glShaderSource, for
+ * generated sources that carry a lot the driver would only throw away:
+ *   - comments and redundant whitespace are stripped
+ *   - #define bodies that are constant integer expressions are folded,
+ *     as long as every name they use has one value for the whole source
+ *   - functions never called (directly or through other live functions)
+ *     and uniforms never referenced are removed
+ * Every newline is kept, so driver error lines still match the file.
+ * Anything the passes can't parse with confidence is left as it was.
+ *
+ * With measuring on, every optimized stage is also compiled as written so
+ * ShaderOptimize_printReport can show the time saved. That compile blocks,
+ * so only measure while profiling.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "shader_source.h"
+#include "shader_timing.h"
+
+#define SHADER_OPTIMIZE_MAX_DEFINES 256
+
+void ShaderOptimize_configure(bool enabled, bool measure);
+bool ShaderOptimize_apply(GLenum type, const struct ShaderSource* source,
+                          struct ShaderSource* optimized);
+void ShaderOptimize_printReport(void);
+/* utility functions */
+struct OptimizeText;
+struct OptimizeFunction;
+struct OptimizeDirective;
+static void appendText(struct OptimizeText* text, const char* data, size_t length);
+static void appendBlank(struct OptimizeText* text, const char* data, size_t length);
+static bool isIdentifierStart(char c);
+static bool isIdentifierChar(char c);
+static void stripComments(const char* code, size_t length, struct OptimizeText* out);
+static void foldDefines(const char* code, size_t length, struct OptimizeText* out);
+static bool parseDefineLine(const char* text, size_t length, int* depth,
+                            struct OptimizeDirective* directive);
+static struct OptimizeDefine* findDefine(const char* name, size_t nameLength);
+static bool evaluateDefine(const char* body, size_t length, long long* value, bool* literal);
+static bool parseExpression(const char** cursor, const char* end, int precedence,
+                            long long* value);
+static bool parseOperand(const char** cursor, const char* end, long long* value);
+static void removeUnusedFunctions(const char* code, size_t length, struct OptimizeText* out);
+static void removeUnusedUniforms(const char* code, size_t length, struct OptimizeText* out);
+static bool isReferenced(const char* code, size_t length, const char* name, size_t nameLength,
+                         const struct OptimizeFunction* skip, int skipCount);
+static double compileMilliseconds(GLenum type, const struct ShaderSource* source);
+
+/* growable output of one pass */
+struct OptimizeText {
+  char* data;
+  size_t length;
+  size_t capacity;
+};
+
+/* a top-level function definition: [start, end) of the source */
+struct OptimizeFunction {
+  size_t start;
+  size_t end;
+  size_t name;
+  size_t nameLength;
+  bool removable; /* false if it straddles a preprocessor conditional */
+  bool removed;
+};
+
+/* a name some #define or #undef mentions */
+struct OptimizeDefine {
+  char name[64];
+  int directives; /* #define and #undef lines naming it */
+  bool conditional; /* one of them is inside an #if */
+  long long value;
+  bool folded; /* value is what it expands to from here to the end */
+};
+
+/* a #define or #undef line, split up */
+struct OptimizeDirective {
+  bool define;
+  const char* name;
+  size_t nameLength;
+  const char* body;
+  size_t bodyLength;
+};
+
+struct OptimizeRecord {
+  GLenum type;
+  size_t originalSize;
+  size_t optimizedSize;
+  double originalMs; /* negative when not measured */
+  double optimizedMs;
+};
+
+static struct {
+  bool enabled;
+  bool measure;
+  struct OptimizeDefine defines[SHADER_OPTIMIZE_MAX_DEFINES];
+  int defineCount;
+  struct OptimizeRecord* records;
+  int count;
+  int capacity;
+} shaderOptimizer;
+
+/* off by default; Shader_new and friends consult this on every compile */
+void ShaderOptimize_configure(bool enabled, bool measure)
+{
+  shaderOptimizer.enabled = enabled;
+  shaderOptimizer.measure = enabled && measure;
+}
+
+/**
+ * Writes the optimized text of source to optimized (heap storage, release
+ * it with ShaderSource_release). Returns false, leaving optimized
+ * untouched, when the optimizer is off.
+*/
+bool ShaderOptimize_apply(GLenum type, const struct ShaderSource* source,
+                          struct ShaderSource* optimized)
+{
+  struct OptimizeText stripped = { NULL, 0, 0 };
+  struct OptimizeText folded = { NULL, 0, 0 };
+  struct OptimizeText pruned = { NULL, 0, 0 };
+  struct OptimizeText result = { NULL, 0, 0 };
+  if (!shaderOptimizer.enabled || source->storage == SHADER_SOURCE_NONE)
+    return false;
+
+  stripComments(source->code, (size_t)source->length, &stripped);
+  foldDefines(stripped.data, stripped.length, &folded);
+  removeUnusedFunctions(folded.data, folded.length, &pruned);
+  removeUnusedUniforms(pruned.data, pruned.length, &result);
+  free(stripped.data);
+  free(folded.data);
+  free(pruned.data);
+
+  optimized->code = result.data;
+  optimized->length = (GLint)result.length;
+  optimized->storage = SHADER_SOURCE_HEAP;
+
+  if (shaderOptimizer.count == shaderOptimizer.capacity)
+  {
+    int capacity = shaderOptimizer.capacity ? shaderOptimizer.capacity * 2 : 16;
+    struct OptimizeRecord* records = (struct OptimizeRecord*)realloc(
+      shaderOptimizer.records, capacity * sizeof(struct OptimizeRecord));
+    if (records == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderOptimizer.records = records;
+    shaderOptimizer.capacity = capacity;
+  }
+  struct OptimizeRecord* record = &shaderOptimizer.records[shaderOptimizer.count++];
+  record->type = type;
+  record->originalSize = (size_t)source->length;
+  record->optimizedSize = result.length;
+  record->originalMs = -1.0;
+  record->optimizedMs = -1.0;
+  /* optimized first: any driver warm-up counts against it, not for it */
+  if (shaderOptimizer.measure)
+  {
+    record->optimizedMs = compileMilliseconds(type, optimized);
+    record->originalMs = compileMilliseconds(type, source);
+  }
+  return true;
+}
+
+void ShaderOptimize_printReport(void)
+{
+  size_t originalTotal = 0, optimizedTotal = 0;
+  double originalMs = 0.0, optimizedMs = 0.0;
+  for (int i = 0; i < shaderOptimizer.count; i++)
+  {
+    const struct OptimizeRecord* record = &shaderOptimizer.records[i];
+    printf("  %-8s #%-3d %6zu -> %6zu bytes", record->type == GL_VERTEX_SHADER ? "vertex" :
+           "fragment", i, record->originalSize, record->optimizedSize);
+    if (record->originalMs >= 0.0)
+      printf(", compile %.2f -> %.2f ms", record->originalMs, record->optimizedMs);
+    printf("\n");
+    originalTotal += record->originalSize;
+    optimizedTotal += record->optimizedSize;
+    if (record->originalMs >= 0.0)
+    {
+      originalMs += record->originalMs;
+      optimizedMs += record->optimizedMs;
+    }
+  }
+  printf("shader optimizer: %d shaders, %zu -> %zu bytes (%.1f%% smaller)",
+         shaderOptimizer.count, originalTotal, optimizedTotal,
+         originalTotal ? 100.0 * (1.0 - (double)optimizedTotal / (double)originalTotal) : 0.0);
+  if (shaderOptimizer.measure)
+    printf(", compile %.2f -> %.2f ms", originalMs, optimizedMs);
+  printf("\n");
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+void appendText(struct OptimizeText* text, const char* data, size_t length)
+{
+  if (text->length + length + 1 > text->capacity)
+  {
+    size_t capacity = text->capacity ? text->capacity : 256;
+    while (capacity < text->length + length + 1)
+      capacity *= 2;
+    char* grown = (char*)realloc(text->data, capacity);
+    if (grown == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    text->data = grown;
+    text->capacity = capacity;
+  }
+  memcpy(text->data + text->length, data, length);
+  text->length += length;
+  text->data[text->length] = '\0';
+}
+
+/* only the newlines of data, so the lines after it keep their numbers */
+void appendBlank(struct OptimizeText* text, const char* data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+    if (data[i] == '\n')
+      appendText(text, "\n", 1);
+}
+
+bool isIdentifierStart(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isIdentifierChar(char c)
+{
+  return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+/* drops comments, indentation, trailing blanks and runs of spaces */
+void stripComments(const char* code, size_t length, struct OptimizeText* out)
+{
+  bool lineStart = true;
+  bool pendingSpace = false;
+  size_t i = 0;
+  appendText(out, "", 0);
+  while (i < length)
+  {
+    char c = code[i];
+    if (c == '/' && i + 1 < length && code[i + 1] == '/')
+    {
+      while (i < length && code[i] != '\n')
+        i++;
+      continue;
+    }
+    if (c == '/' && i + 1 < length && code[i + 1] == '*')
+    {
+      const char* close = NULL;
+      for (size_t j = i + 2; j + 1 < length && close == NULL; j++)
+        if (code[j] == '*' && code[j + 1] == '/')
+          close = code + j + 2;
+      size_t end = close ? (size_t)(close - code) : length;
+      bool multiline = memchr(code + i, '\n', end - i) != NULL;
+      appendBlank(out, code + i, end - i);
+      if (multiline)
+      {
+        lineStart = true;
+        pendingSpace = false;
+      }
+      else if (!lineStart)
+        pendingSpace = true;
+      i = end;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r')
+    {
+      pendingSpace = !lineStart;
+      i++;
+      continue;
+    }
+    if (c == '\n')
+    {
+      appendText(out, "\n", 1);
+      lineStart = true;
+      pendingSpace = false;
+      i++;
+      continue;
+    }
+    if (pendingSpace)
+      appendText(out, " ", 1);
+    appendText(out, &c, 1);
+    lineStart = false;
+    pendingSpace = false;
+    i++;
+  }
+}
+
+/**
+ * Replaces `#define NAME <integer expression>` with its value. Macros
+ * expand where they are used, not where they are defined, so a body is
+ * only folded when every name in it is defined exactly once, outside any
+ * #if, and never #undef'd: then it expands to the same value everywhere.
+ * A first pass over the source finds those names.
+*/
+void foldDefines(const char* code, size_t length, struct OptimizeText* out)
+{
+  struct OptimizeDirective directive;
+  int depth = 0;
+  shaderOptimizer.defineCount = 0;
+  for (size_t line = 0; line < length; )
+  {
+    const char* newline = (const char*)memchr(code + line, '\n', length - line);
+    size_t end = newline ? (size_t)(newline - code) : length;
+    if (parseDefineLine(code + line, end - line, &depth, &directive))
+    {
+      struct OptimizeDefine* entry = findDefine(directive.name, directive.nameLength);
+      if (entry == NULL && directive.nameLength < sizeof(entry->name) &&
+          shaderOptimizer.defineCount < SHADER_OPTIMIZE_MAX_DEFINES)
+      {
+        entry = &shaderOptimizer.defines[shaderOptimizer.defineCount++];
+        memcpy(entry->name, directive.name, directive.nameLength);
+        entry->name[directive.nameLength] = '\0';
+        entry->directives = 0;
+        entry->conditional = false;
+        entry->folded = false;
+      }
+      if (entry != NULL)
+      {
+        entry->directives++;
+        entry->conditional |= depth > 0;
+      }
+    }
+    line = end + 1;
+  }
+
+  depth = 0;
+  appendText(out, "", 0);
+  for (size_t line = 0; line < length; )
+  {
+    const char* newline = (const char*)memchr(code + line, '\n', length - line);
+    size_t end = newline ? (size_t)(newline - code) : length;
+    const char* text = code + line;
+    size_t textLength = end - line;
+    bool handled = false;
+
+    long long value = 0;
+    bool literal = false;
+    /* a function-like macro has '(' straight after the name */
+    if (parseDefineLine(text, textLength, &depth, &directive) && directive.define &&
+        (directive.bodyLength == 0 || directive.body[0] == ' ') &&
+        evaluateDefine(directive.body, directive.bodyLength, &value, &literal))
+    {
+      /* only now, so the names defined after it can't feed it */
+      struct OptimizeDefine* entry = findDefine(directive.name, directive.nameLength);
+      if (entry != NULL && entry->directives == 1 && !entry->conditional)
+      {
+        entry->value = value;
+        entry->folded = true;
+      }
+      if (!literal)
+      {
+        char folded[32];
+        int foldedLength = sprintf(folded, value < 0 ? " (%lld)" : " %lld", value);
+        appendText(out, text, (size_t)(directive.body - text));
+        appendText(out, folded, (size_t)foldedLength);
+        handled = true;
+      }
+    }
+    if (!handled)
+      appendText(out, text, textLength);
+    if (newline)
+      appendText(out, "\n", 1);
+    line = end + 1;
+  }
+}
+
+/* true for #define and #undef; depth follows the #if nesting either way */
+bool parseDefineLine(const char* text, size_t length, int* depth,
+                     struct OptimizeDirective* directive)
+{
+  if (length == 0 || text[0] != '#')
+    return false;
+  const char* word = text + 1 + (length > 1 && text[1] == ' ');
+  size_t rest = length - (size_t)(word - text);
+  if (rest >= 2 && strncmp(word, "if", 2) == 0)
+    (*depth)++;
+  else if (rest >= 5 && strncmp(word, "endif", 5) == 0)
+    (*depth)--;
+  else if ((rest >= 7 && strncmp(word, "define ", 7) == 0) ||
+           (rest >= 6 && strncmp(word, "undef ", 6) == 0))
+  {
+    directive->define = word[0] == 'd';
+    directive->name = word + (directive->define ? 7 : 6);
+    directive->nameLength = 0;
+    while (directive->name + directive->nameLength < text + length &&
+           isIdentifierChar(directive->name[directive->nameLength]))
+      directive->nameLength++;
+    directive->body = directive->name + directive->nameLength;
+    directive->bodyLength = (size_t)(text + length - directive->body);
+    return directive->nameLength > 0;
+  }
+  return false;
+}
+
+struct OptimizeDefine* findDefine(const char* name, size_t nameLength)
+{
+  for (int i = 0; i < shaderOptimizer.defineCount; i++)
+    if (strlen(shaderOptimizer.defines[i].name) == nameLength &&
+        strncmp(shaderOptimizer.defines[i].name, name, nameLength) == 0)
+      return &shaderOptimizer.defines[i];
+  return NULL;
+}
+
+/**
+ * True if body is an int-sized constant expression. literal is set when
+ * it is a plain number already, so there is nothing to rewrite.
+*/
+bool evaluateDefine(const char* body, size_t length, long long* value, bool* literal)
+{
+  const char* cursor = body;
+  const char* end = body + length;
+  *literal = true;
+  for (size_t i = 0; i < length; i++)
+    *literal &= body[i] == ' ' || (body[i] >= '0' && body[i] <= '9');
+  if (length == 0)
+    return false;
+  if (!parseExpression(&cursor, end, 0, value))
+    return false;
+  while (cursor < end && *cursor == ' ')
+    cursor++;
+  return cursor == end && *value >= -2147483647LL - 1 && *value <= 2147483647LL;
+}
+
+/* precedence climbing over the C integer operators GLSL shares */
+bool parseExpression(const char** cursor, const char* end, int precedence, long long* value)
+{
+  static const struct { const char* op; int precedence; } operators[] = {
+    { "<<", 5 }, { ">>", 5 }, { "|", 1 }, { "^", 2 }, { "&", 3 },
+    { "+", 6 }, { "-", 6 }, { "*", 7 }, { "/", 7 }, { "%", 7 },
+  };
+  if (!parseOperand(cursor, end, value))
+    return false;
+  for (;;)
+  {
+    while (*cursor < end && **cursor == ' ')
+      (*cursor)++;
+    int found = -1;
+    for (int i = 0; i < (int)(sizeof(operators) / sizeof(operators[0])) && found == -1; i++)
+    {
+      size_t opLength = strlen(operators[i].op);
+      if ((size_t)(end - *cursor) >= opLength && strncmp(*cursor, operators[i].op, opLength) == 0)
+        found = i;
+    }
+    if (found == -1 || operators[found].precedence <= precedence)
+      return true;
+    const char* op = operators[found].op;
+    /* comparisons and && || are not folded */
+    if ((op[0] == '&' || op[0] == '|') && *cursor + 1 < end && (*cursor)[1] == op[0])
+      return false;
+    *cursor += strlen(op);
+    long long right;
+    if (!parseExpression(cursor, end, operators[found].precedence, &right))
+      return false;
+    switch (op[0])
+    {
+    case '<': if (right < 0 || right > 31) return false; *value <<= right; break;
+    case '>': if (right < 0 || right > 31) return false; *value >>= right; break;
+    case '|': *value |= right; break;
+    case '^': *value ^= right; break;
+    case '&': *value &= right; break;
+    case '+': *value += right; break;
+    case '-': *value -= right; break;
+    case '*': *value *= right; break;
+    case '/': if (right == 0) return false; *value /= right; break;
+    case '%': if (right == 0) return false; *value %= right; break;
+    }
+    if (*value < -2147483647LL - 1 || *value > 2147483647LL)
+      return false;
+  }
+}
+
+bool parseOperand(const char** cursor, const char* end, long long* value)
+{
+  while (*cursor < end && **cursor == ' ')
+    (*cursor)++;
+  if (*cursor == end)
+    return false;
+  char c = **cursor;
+  if (c == '(')
+  {
+    (*cursor)++;
+    if (!parseExpression(cursor, end, 0, value))
+      return false;
+    while (*cursor < end && **cursor == ' ')
+      (*cursor)++;
+    if (*cursor == end || **cursor != ')')
+      return false;
+    (*cursor)++;
+    return true;
+  }
+  if (c == '-' || c == '~' || c == '+')
+  {
+    (*cursor)++;
+    if (!parseOperand(cursor, end, value))
+      return false;
+    *value = c == '-' ? -*value : c == '~' ? ~*value : *value;
+    return true;
+  }
+  if (c >= '0' && c <= '9')
+  {
+    char* stop;
+    *value = strtoll(*cursor, &stop, 0);
+    /* a float or suffixed literal changes the type, leave it alone */
+    if (stop < end && (isIdentifierChar(*stop) || *stop == '.'))
+      return false;
+    *cursor = stop;
+    return true;
+  }
+  if (isIdentifierStart(c))
+  {
+    size_t nameLength = 0;
+    while (*cursor + nameLength < end && isIdentifierChar((*cursor)[nameLength]))
+      nameLength++;
+    for (int i = 0; i < shaderOptimizer.defineCount; i++)
+    {
+      const struct OptimizeDefine* define = &shaderOptimizer.defines[i];
+      if (define->folded && strlen(define->name) == nameLength &&
+          strncmp(define->name, *cursor, nameLength) == 0)
+      {
+        *value = define->value;
+        *cursor += nameLength;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Finds every top-level function definition and drops the ones whose name
+ * appears nowhere outside dropped code, repeating until nothing changes so
+ * helpers of dead functions go too. Gives up on unbalanced braces.
+*/
+void removeUnusedFunctions(const char* code, size_t length, struct OptimizeText* out)
+{
+  struct OptimizeFunction* functions = NULL;
+  int count = 0, capacity = 0;
+  int depth = 0;
+  bool balanced = true;
+  size_t statement = 0;
+  bool lineStart = true;
+  struct OptimizeFunction current = { 0, 0, 0, 0, false, false };
+
+  for (size_t i = 0; i < length && balanced; i++)
+  {
+    char c = code[i];
+    /* directives are not code; skip to the end of the line */
+    if (lineStart && c == '#')
+    {
+      while (i < length && code[i] != '\n')
+        i++;
+      if (depth == 0)
+        statement = i + 1;
+      lineStart = true;
+      continue;
+    }
+    lineStart = c == '\n';
+    if (c == '{')
+    {
+      if (depth == 0)
+      {
+        size_t close = i;
+        while (close > statement && (code[close - 1] == ' ' || code[close - 1] == '\n'))
+          close--;
+        current.start = statement;
+        current.nameLength = 0;
+        if (close > statement && code[close - 1] == ')')
+        {
+          /* back to the '(' and the name before it */
+          size_t open = close - 1;
+          int parens = 0;
+          while (open > statement && !(code[open] == '(' && parens == 1))
+          {
+            parens += code[open] == ')';
+            parens -= code[open] == '(';
+            open--;
+          }
+          size_t nameEnd = open;
+          while (nameEnd > statement && code[nameEnd - 1] == ' ')
+            nameEnd--;
+          size_t name = nameEnd;
+          while (name > statement && isIdentifierChar(code[name - 1]))
+            name--;
+          current.name = name;
+          current.nameLength = nameEnd - name;
+        }
+      }
+      depth++;
+    }
+    else if (c == '}')
+    {
+      if (--depth < 0)
+        balanced = false;
+      else if (depth == 0 && current.nameLength > 0)
+      {
+        if (count == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 16;
+          functions = (struct OptimizeFunction*)realloc(functions,
+                                                        capacity * sizeof(struct OptimizeFunction));
+          if (functions == NULL)
+          {
+            printf("Memory not allocated.\n");
+            exit(EXIT_FAILURE);
+          }
+        }
+        current.end = i + 1;
+        current.removed = false;
+        /* a definition split by #if/#else can't be cut out as one piece */
+        current.removable = !(current.nameLength == 4 &&
+                              strncmp(code + current.name, "main", 4) == 0);
+        for (size_t j = current.start; j < current.end && current.removable; j++)
+          if (code[j] == '#' && (j == 0 || code[j - 1] == '\n'))
+            current.removable = false;
+        functions[count++] = current;
+        current.nameLength = 0;
+        statement = i + 1;
+      }
+      else if (depth == 0)
+        statement = i + 1;
+    }
+    else if (c == ';' && depth == 0)
+      statement = i + 1;
+  }
+
+  bool changed = balanced && depth == 0;
+  while (changed)
+  {
+    changed = false;
+    for (int i = 0; i < count; i++)
+    {
+      struct OptimizeFunction* function = &functions[i];
+      if (!function->removable || function->removed)
+        continue;
+      /* overloads share a name; they live or die together */
+      function->removed = true;
+      for (int j = 0; j < count; j++)
+        if (functions[j].nameLength == function->nameLength &&
+            strncmp(code + functions[j].name, code + function->name, function->nameLength) == 0)
+          functions[j].removed = true;
+      if (isReferenced(code, length, code + function->name, function->nameLength,
+                       functions, count))
+      {
+        for (int j = 0; j < count; j++)
+          if (functions[j].nameLength == function->nameLength &&
+              strncmp(code + functions[j].name, code + function->name, function->nameLength) == 0)
+            functions[j].removed = false;
+      }
+      else
+        changed = true;
+    }
+  }
+
+  appendText(out, "", 0);
+  size_t copied = 0;
+  for (int i = 0; i < count && balanced && depth == 0; i++)
+  {
+    if (!functions[i].removed)
+      continue;
+    appendText(out, code + copied, functions[i].start - copied);
+    appendBlank(out, code + functions[i].start, functions[i].end - functions[i].start);
+    copied = functions[i].end;
+  }
+  appendText(out, code + copied, length - copied);
+  free(functions);
+}
+
+/* drops `uniform <type> <name>;` declarations nothing refers to */
+void removeUnusedUniforms(const char* code, size_t length, struct OptimizeText* out)
+{
+  int depth = 0;
+  size_t statement = 0;
+  size_t copied = 0;
+  bool lineStart = true;
+  appendText(out, "", 0);
+  for (size_t i = 0; i < length; i++)
+  {
+    char c = code[i];
+    if (lineStart && c == '#')
+    {
+      while (i < length && code[i] != '\n')
+        i++;
+      if (depth == 0)
+        statement = i + 1;
+      continue;
+    }
+    lineStart = c == '\n';
+    depth += (c == '{') - (c == '}');
+    if (depth != 0 || (c != ';' && c != '}'))
+      continue;
+
+    size_t start = statement;
+    statement = i + 1;
+    if (c != ';')
+      continue;
+    while (start < i && (code[start] == ' ' || code[start] == '\n'))
+      start++;
+    /* `uniform` then exactly two words: type and name, with an optional [N] */
+    if (i - start < 8 || strncmp(code + start, "uniform ", 8) != 0)
+      continue;
+    const char* words[2];
+    size_t wordLengths[2];
+    int wordCount = 0;
+    const char* p = code + start + 8;
+    bool simple = true;
+    while (p < code + i && simple)
+    {
+      if (*p == ' ')
+        p++;
+      else if (isIdentifierStart(*p) && wordCount < 2)
+      {
+        words[wordCount] = p;
+        while (p < code + i && isIdentifierChar(*p))
+          p++;
+        wordLengths[wordCount] = (size_t)(p - words[wordCount]);
+        wordCount++;
+      }
+      else if (*p == '[' && wordCount == 2)
+        p = code + i; /* the array size doesn't matter */
+      else
+        simple = false;
+    }
+    if (!simple || wordCount != 2)
+      continue;
+    /* a lone reference to itself doesn't count, see isReferenced */
+    struct OptimizeFunction declaration = { start, i + 1, 0, 0, true, true };
+    if (isReferenced(code, length, words[1], wordLengths[1], &declaration, 1))
+      continue;
+    appendText(out, code + copied, start - copied);
+    appendBlank(out, code + start, i + 1 - start);
+    copied = i + 1;
+  }
+  appendText(out, code + copied, length - copied);
+}
+
+/* whether name occurs as a whole identifier outside the removed ranges */
+bool isReferenced(const char* code, size_t length, const char* name, size_t nameLength,
+                  const struct OptimizeFunction* skip, int skipCount)
+{
+  size_t i = 0;
+  while (i < length)
+  {
+    if (!isIdentifierStart(code[i]) || (i > 0 && isIdentifierChar(code[i - 1])))
+    {
+      i++;
+      continue;
+    }
+    size_t start = i;
+    while (i < length && isIdentifierChar(code[i]))
+      i++;
+    if (i - start != nameLength || strncmp(code + start, name, nameLength) != 0)
+      continue;
+    bool skipped = false;
+    for (int j = 0; j < skipCount && !skipped; j++)
+      skipped = skip[j].removed && start >= skip[j].start && start < skip[j].end;
+    if (!skipped)
+      return true;
+  }
+  return false;
+}
+
+/* one blocking compile, for the report */
+double compileMilliseconds(GLenum type, const struct ShaderSource* source)
+{
+  int status;
+  unsigned int shader = glCreateShader(type);
+  double start = ShaderTiming_now();
+  ShaderSource_compile(shader, source);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  double milliseconds = ShaderTiming_now() - start;
+  glDeleteShader(shader);
+  return milliseconds;
+}
+
+#endif
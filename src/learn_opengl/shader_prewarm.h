@@ -0,0 +1,493 @@
+#ifndef SHADER_PREWARM_H
+#define SHADER_PREWARM_H
+
+/**
+ * Shader Prewarm
+ * --------------
+ * Drivers often finish compiling a program only at its first draw, once
+ * they know the vertex layout and blend/depth state it runs with, so the
+ * first frame that draws something new hitches. This records the
+ * combinations a session draws in a manifest. On the next launch
+ * ShaderPrewarm_replay draws each one into a 1x1 offscreen target while
+ * the loading screen is up.
+ *
+ * Programs are matched by the hash of their sources, so an edited shader
+ * drops its old entries. A combination is recorded the first time its
+ * program, vertex array, mode and pipeline state are seen together. The
+ * state is the one PipelineState applied last, or a fresh context's before
+ * any PipelineState_apply; draws made around PipelineState are recorded
+ * with the wrong state.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gl_state.h"
+#include "pipeline_state.h"
+#include "shader.h"
+#include "shader_timing.h"
+
+#define SHADER_PREWARM_ATTRIBUTES 16
+#define SHADER_PREWARM_SEEN 64 /* first size of the seen set */
+#define SHADER_PREWARM_SCRATCH_SIZE 4096
+
+struct PrewarmCombination;
+
+bool ShaderPrewarm_open(const char* path);
+void ShaderPrewarm_record(Shader_T sh, GLenum mode);
+void ShaderPrewarm_replay(Shader_T* shaders, int count);
+void ShaderPrewarm_close(void);
+/* utility functions */
+struct PrewarmDraw;
+static bool markSeen(const struct PrewarmDraw* draw);
+static uint64_t prewarmDrawHash(const struct PrewarmDraw* draw);
+static void captureCombination(Shader_T sh, GLenum mode, const struct PipelineStateDesc* applied,
+                               struct PrewarmCombination* combination);
+static bool addCombination(const struct PrewarmCombination* combination, bool recorded);
+static bool parseCombination(const char* line, struct PrewarmCombination* combination);
+static unsigned int prewarmVertexArray(const struct PrewarmCombination* combination, unsigned int scratch);
+static void prewarmUniformBlocks(Shader_T sh, unsigned int scratch);
+
+struct PrewarmAttribute {
+  unsigned int index;
+  int size;
+  GLenum type;
+  int normalized;
+  int integer;
+  int stride;
+  unsigned int offset;
+  unsigned int divisor;
+};
+
+/* everything a draw specializes on; zero-filled so it compares with memcmp */
+struct PrewarmCombination {
+  uint64_t program; /* Shader_T key */
+  uint64_t state; /* PipelineState_hashFixed of the groups below */
+  GLenum mode;
+  struct BlendState blend;
+  struct DepthState depth;
+  struct StencilState stencil;
+  struct RasterState raster;
+  int attributeCount;
+  struct PrewarmAttribute attributes[SHADER_PREWARM_ATTRIBUTES];
+};
+
+struct PrewarmEntry {
+  struct PrewarmCombination combination;
+  bool keep; /* drawn or replayed this session, so written back */
+};
+
+/* a program, vertex array, mode and state seen together this session */
+struct PrewarmDraw {
+  uint64_t state;
+  unsigned int program;
+  unsigned int vertexArray;
+  GLenum mode;
+};
+
+static struct {
+  char* path;
+  struct PrewarmEntry* entries;
+  int count;
+  int capacity;
+  struct PrewarmDraw* seen; /* open addressing; program 0 marks a free slot */
+  int seenCount;
+  int seenCapacity;
+  int recorded;
+} shaderPrewarm;
+
+/* loads the manifest left by the last session; recording starts either way */
+bool ShaderPrewarm_open(const char* path)
+{
+  char line[1024];
+  shaderPrewarm.path = (char*)malloc(strlen(path) + 1);
+  if (shaderPrewarm.path == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(shaderPrewarm.path, path);
+
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+    return false; /* first run */
+  while (fgets(line, sizeof(line), file))
+  {
+    struct PrewarmCombination combination;
+    if (line[0] != '#' && parseCombination(line, &combination))
+      addCombination(&combination, false);
+  }
+  fclose(file);
+  return true;
+}
+
+/* call before a draw; costs a hash lookup once the combination is known */
+void ShaderPrewarm_record(Shader_T sh, GLenum mode)
+{
+  struct PipelineStateDesc applied;
+  struct PrewarmDraw draw;
+  if (!PipelineState_applied(&applied))
+    applied = PipelineState_defaults();
+  /* zeroed first, the padding is hashed and compared too */
+  memset(&draw, 0, sizeof(draw));
+  draw.state = PipelineState_hashFixed(&applied);
+  draw.program = sh->ID;
+  draw.vertexArray = GLState_vertexArray();
+  draw.mode = mode;
+  if (draw.program == 0 || !markSeen(&draw))
+    return;
+
+  struct PrewarmCombination combination;
+  captureCombination(sh, mode, &applied, &combination);
+  shaderPrewarm.recorded += addCombination(&combination, true);
+}
+
+/**
+ * Draws every manifest entry whose program is among shaders into a
+ * throwaway 1x1 framebuffer, with zero-filled vertex and uniform buffers.
+ * Leaves framebuffer 0, the old viewport and default pipeline state bound.
+*/
+void ShaderPrewarm_replay(Shader_T* shaders, int count)
+{
+  unsigned int framebuffer, color, depthStencil, scratch;
+  int viewport[4];
+  int draws = 0;
+  double start = ShaderTiming_now();
+  if (shaderPrewarm.count == 0)
+    return;
+
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGenFramebuffers(1, &framebuffer);
+  GLState_bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glGenRenderbuffers(1, &color);
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+  glGenRenderbuffers(1, &depthStencil);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+  glViewport(0, 0, 1, 1);
+
+  void* zeros = calloc(1, SHADER_PREWARM_SCRATCH_SIZE);
+  if (zeros == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  glGenBuffers(1, &scratch);
+  GLState_bindBuffer(GL_ARRAY_BUFFER, scratch);
+  glBufferData(GL_ARRAY_BUFFER, SHADER_PREWARM_SCRATCH_SIZE, zeros, GL_STATIC_DRAW);
+  free(zeros);
+
+  for (int i = 0; i < shaderPrewarm.count; i++)
+  {
+    struct PrewarmEntry* entry = &shaderPrewarm.entries[i];
+    Shader_T sh = NULL;
+    for (int j = 0; j < count && sh == NULL; j++)
+      if (shaders[j]->ID != 0 && shaders[j]->key == entry->combination.program)
+        sh = shaders[j];
+    if (sh == NULL)
+      continue;
+
+    struct PipelineStateDesc desc = PipelineState_defaults();
+    desc.program = sh->ID;
+    desc.vertexArray = prewarmVertexArray(&entry->combination, scratch);
+    desc.blend = entry->combination.blend;
+    desc.depth = entry->combination.depth;
+    desc.stencil = entry->combination.stencil;
+    desc.raster = entry->combination.raster;
+    PipelineState_T state = PipelineState_new(&desc);
+    PipelineState_apply(state);
+    prewarmUniformBlocks(sh, scratch);
+    glDrawArrays(entry->combination.mode, 0, 3);
+    PipelineState_free(state);
+
+    GLState_bindVertexArray(0);
+    glDeleteVertexArrays(1, &desc.vertexArray);
+    GLState_forget(desc.vertexArray);
+    entry->keep = true;
+    draws++;
+  }
+
+  /* put back what a fresh context would have */
+  struct PipelineStateDesc defaults = PipelineState_defaults();
+  PipelineState_T state = PipelineState_new(&defaults);
+  PipelineState_apply(state);
+  PipelineState_free(state);
+  GLState_bindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  glDeleteBuffers(1, &scratch);
+  GLState_forget(scratch);
+  glDeleteRenderbuffers(1, &color);
+  glDeleteRenderbuffers(1, &depthStencil);
+  glDeleteFramebuffers(1, &framebuffer);
+  GLState_forget(framebuffer);
+  /* the driver work happens here, not during the first frames */
+  glFinish();
+  printf("shader prewarm: %d draws in %.3f ms\n", draws, ShaderTiming_now() - start);
+}
+
+/* writes back everything drawn or replayed this session */
+void ShaderPrewarm_close(void)
+{
+  FILE* file = shaderPrewarm.path ? fopen(shaderPrewarm.path, "w") : NULL;
+  if (shaderPrewarm.path && file == NULL)
+    perror(shaderPrewarm.path);
+  if (file)
+  {
+    fprintf(file, "# program state mode"
+                  " | blend src dst srcAlpha dstAlpha equation"
+                  " | depth write func"
+                  " | stencil func ref readMask writeMask fail depthFail pass"
+                  " | cull cullFace frontFace polygonMode"
+                  " | attributes (index size type normalized integer stride offset divisor)...\n");
+    for (int i = 0; i < shaderPrewarm.count; i++)
+    {
+      const struct PrewarmCombination* c = &shaderPrewarm.entries[i].combination;
+      if (!shaderPrewarm.entries[i].keep)
+        continue;
+      fprintf(file, "%016llx %016llx %u", (unsigned long long)c->program,
+              (unsigned long long)c->state, c->mode);
+      fprintf(file, " | %d %u %u %u %u %u", c->blend.enabled, c->blend.srcColor,
+              c->blend.dstColor, c->blend.srcAlpha, c->blend.dstAlpha, c->blend.equation);
+      fprintf(file, " | %d %d %u", c->depth.enabled, c->depth.write, c->depth.func);
+      fprintf(file, " | %d %u %d %u %u %u %u %u", c->stencil.enabled, c->stencil.func,
+              c->stencil.ref, c->stencil.readMask, c->stencil.writeMask, c->stencil.fail,
+              c->stencil.depthFail, c->stencil.pass);
+      fprintf(file, " | %d %u %u %u", c->raster.cull, c->raster.cullFace,
+              c->raster.frontFace, c->raster.polygonMode);
+      fprintf(file, " | %d", c->attributeCount);
+      for (int a = 0; a < c->attributeCount; a++)
+      {
+        const struct PrewarmAttribute* attribute = &c->attributes[a];
+        fprintf(file, " %u %d %u %d %d %d %u %u", attribute->index, attribute->size,
+                attribute->type, attribute->normalized, attribute->integer,
+                attribute->stride, attribute->offset, attribute->divisor);
+      }
+      fprintf(file, "\n");
+    }
+    fclose(file);
+  }
+  printf("shader prewarm: %d entries, %d new this session\n",
+         shaderPrewarm.count, shaderPrewarm.recorded);
+  free(shaderPrewarm.entries);
+  free(shaderPrewarm.seen);
+  free(shaderPrewarm.path);
+  memset(&shaderPrewarm, 0, sizeof(shaderPrewarm));
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* adds draw to the seen set; false if it was there already */
+bool markSeen(const struct PrewarmDraw* draw)
+{
+  if (2 * (shaderPrewarm.seenCount + 1) > shaderPrewarm.seenCapacity)
+  {
+    int capacity = shaderPrewarm.seenCapacity ? 2 * shaderPrewarm.seenCapacity : SHADER_PREWARM_SEEN;
+    struct PrewarmDraw* old = shaderPrewarm.seen;
+    int oldCapacity = shaderPrewarm.seenCapacity;
+    shaderPrewarm.seen = (struct PrewarmDraw*)calloc(capacity, sizeof(struct PrewarmDraw));
+    if (shaderPrewarm.seen == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderPrewarm.seenCapacity = capacity;
+    shaderPrewarm.seenCount = 0;
+    for (int i = 0; i < oldCapacity; i++)
+      if (old[i].program != 0)
+        markSeen(&old[i]);
+    free(old);
+  }
+
+  int mask = shaderPrewarm.seenCapacity - 1;
+  for (int i = (int)(prewarmDrawHash(draw) & mask); ; i = (i + 1) & mask)
+  {
+    struct PrewarmDraw* slot = &shaderPrewarm.seen[i];
+    if (slot->program == 0)
+    {
+      *slot = *draw;
+      shaderPrewarm.seenCount++;
+      return true;
+    }
+    if (memcmp(slot, draw, sizeof(*draw)) == 0)
+      return false;
+  }
+}
+
+uint64_t prewarmDrawHash(const struct PrewarmDraw* draw)
+{
+  uint64_t hash = 14695981039346656037ull;
+  const unsigned char* bytes = (const unsigned char*)draw;
+  for (size_t i = 0; i < sizeof(*draw); i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+}
+
+/* reads the layout of the bound vertex array; the rest is PipelineState's */
+void captureCombination(Shader_T sh, GLenum mode, const struct PipelineStateDesc* applied,
+                        struct PrewarmCombination* combination)
+{
+  int maxAttributes = 0, value = 0;
+  memset(combination, 0, sizeof(*combination));
+  combination->program = sh->key;
+  combination->state = PipelineState_hashFixed(applied);
+  combination->mode = mode;
+  combination->blend = applied->blend;
+  combination->depth = applied->depth;
+  combination->stencil = applied->stencil;
+  combination->raster = applied->raster;
+
+  glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+  if (maxAttributes > SHADER_PREWARM_ATTRIBUTES)
+    maxAttributes = SHADER_PREWARM_ATTRIBUTES;
+  for (int i = 0; i < maxAttributes; i++)
+  {
+    struct PrewarmAttribute* attribute = &combination->attributes[combination->attributeCount];
+    void* pointer = NULL;
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &value);
+    if (!value)
+      continue;
+    attribute->index = (unsigned int)i;
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute->size);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);
+    attribute->type = (GLenum)value;
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribute->normalized);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attribute->integer);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute->stride);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &value);
+    attribute->divisor = (unsigned int)value;
+    glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+    attribute->offset = (unsigned int)(uintptr_t)pointer;
+    combination->attributeCount++;
+  }
+}
+
+/* false if the combination was already known */
+bool addCombination(const struct PrewarmCombination* combination, bool recorded)
+{
+  for (int i = 0; i < shaderPrewarm.count; i++)
+  {
+    if (memcmp(&shaderPrewarm.entries[i].combination, combination, sizeof(*combination)) == 0)
+    {
+      shaderPrewarm.entries[i].keep |= recorded;
+      return false;
+    }
+  }
+  if (shaderPrewarm.count == shaderPrewarm.capacity)
+  {
+    int capacity = shaderPrewarm.capacity ? 2 * shaderPrewarm.capacity : 16;
+    struct PrewarmEntry* entries = (struct PrewarmEntry*)
+      realloc(shaderPrewarm.entries, capacity * sizeof(struct PrewarmEntry));
+    if (entries == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderPrewarm.entries = entries;
+    shaderPrewarm.capacity = capacity;
+  }
+  shaderPrewarm.entries[shaderPrewarm.count].combination = *combination;
+  shaderPrewarm.entries[shaderPrewarm.count].keep = recorded;
+  shaderPrewarm.count++;
+  return true;
+}
+
+/* the inverse of the line ShaderPrewarm_close writes */
+bool parseCombination(const char* line, struct PrewarmCombination* combination)
+{
+  unsigned long long program, state;
+  int consumed = 0;
+  struct PipelineStateDesc desc = PipelineState_defaults();
+  memset(combination, 0, sizeof(*combination));
+  if (sscanf(line, "%llx %llx %u%n", &program, &state, &combination->mode, &consumed) != 3)
+    return false;
+  line += consumed;
+  if (sscanf(line, " | %d %u %u %u %u %u%n", &desc.blend.enabled, &desc.blend.srcColor,
+             &desc.blend.dstColor, &desc.blend.srcAlpha, &desc.blend.dstAlpha,
+             &desc.blend.equation, &consumed) != 6)
+    return false;
+  line += consumed;
+  if (sscanf(line, " | %d %d %u%n", &desc.depth.enabled, &desc.depth.write, &desc.depth.func,
+             &consumed) != 3)
+    return false;
+  line += consumed;
+  if (sscanf(line, " | %d %u %d %u %u %u %u %u%n", &desc.stencil.enabled, &desc.stencil.func,
+             &desc.stencil.ref, &desc.stencil.readMask, &desc.stencil.writeMask,
+             &desc.stencil.fail, &desc.stencil.depthFail, &desc.stencil.pass, &consumed) != 8)
+    return false;
+  line += consumed;
+  if (sscanf(line, " | %d %u %u %u%n", &desc.raster.cull, &desc.raster.cullFace,
+             &desc.raster.frontFace, &desc.raster.polygonMode, &consumed) != 4)
+    return false;
+  line += consumed;
+  if (sscanf(line, " | %d%n", &combination->attributeCount, &consumed) != 1)
+    return false;
+  /* a line from an older format or edited by hand */
+  if (combination->attributeCount < 0 || combination->attributeCount > SHADER_PREWARM_ATTRIBUTES ||
+      PipelineState_hashFixed(&desc) != (uint64_t)state)
+    return false;
+  combination->state = (uint64_t)state;
+  combination->blend = desc.blend;
+  combination->depth = desc.depth;
+  combination->stencil = desc.stencil;
+  combination->raster = desc.raster;
+  combination->program = (uint64_t)program;
+  line += consumed;
+  for (int a = 0; a < combination->attributeCount; a++)
+  {
+    struct PrewarmAttribute* attribute = &combination->attributes[a];
+    if (sscanf(line, "%u %d %u %d %d %d %u %u%n", &attribute->index, &attribute->size,
+               &attribute->type, &attribute->normalized, &attribute->integer,
+               &attribute->stride, &attribute->offset, &attribute->divisor, &consumed) != 8)
+      return false;
+    line += consumed;
+  }
+  return true;
+}
+
+/* a vertex array with the recorded layout, every attribute reading zeros */
+unsigned int prewarmVertexArray(const struct PrewarmCombination* combination, unsigned int scratch)
+{
+  unsigned int vertexArray;
+  glGenVertexArrays(1, &vertexArray);
+  GLState_bindVertexArray(vertexArray);
+  GLState_bindBuffer(GL_ARRAY_BUFFER, scratch);
+  for (int a = 0; a < combination->attributeCount; a++)
+  {
+    const struct PrewarmAttribute* attribute = &combination->attributes[a];
+    /* three vertices must stay inside the scratch buffer */
+    uintptr_t offset = attribute->offset;
+    if (offset + 3 * (uintptr_t)attribute->stride + 64 > SHADER_PREWARM_SCRATCH_SIZE)
+      offset = 0;
+    if (attribute->integer)
+      glVertexAttribIPointer(attribute->index, attribute->size, attribute->type,
+                             attribute->stride, (void*)offset);
+    else
+      glVertexAttribPointer(attribute->index, attribute->size, attribute->type,
+                            (GLboolean)attribute->normalized, attribute->stride, (void*)offset);
+    glVertexAttribDivisor(attribute->index, attribute->divisor);
+    glEnableVertexAttribArray(attribute->index);
+  }
+  return vertexArray;
+}
+
+/* backs every uniform block of the program with zeros */
+void prewarmUniformBlocks(Shader_T sh, unsigned int scratch)
+{
+  for (int i = 0; i < sh->reflection.blockCount; i++)
+  {
+    const struct BlockInfo* block = &sh->reflection.blocks[i];
+    int binding = 0;
+    if (block->dataSize > SHADER_PREWARM_SCRATCH_SIZE)
+      continue;
+    glGetActiveUniformBlockiv(sh->ID, block->index, GL_UNIFORM_BLOCK_BINDING, &binding);
+    GLState_bindBufferRange(GL_UNIFORM_BUFFER, (unsigned int)binding, scratch, 0, block->dataSize);
+  }
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef SHADER_REGISTRY_H
+#define SHADER_REGISTRY_H
+
+/**
+ * Shader Registry
+ * ---------------
+ * Compiled shader objects shared between programs. A stage is keyed by its
+ * type and its source as loaded, compared by hash and then byte for byte
+ * against a copy, so every program that links identical source attaches
+ * the one object compiled the first time, and a hit skips whatever
+ * rewriting the text would get before the driver sees it. That rewriting
+ * has to depend on the source alone. Each program holds a reference; the
+ * object is deleted when the last program using it lets go.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "shader_source.h"
+
+unsigned int ShaderRegistry_find(GLenum type, const struct ShaderSource* source);
+unsigned int ShaderRegistry_add(GLenum type, const struct ShaderSource* source,
+                                const struct ShaderSource* compiled);
+void ShaderRegistry_release(unsigned int shader);
+void ShaderRegistry_printStats(void);
+/* utility functions */
+static uint64_t registryHash(GLenum type, const struct ShaderSource* source);
+
+struct RegistryEntry {
+  GLenum type;
+  uint64_t hash;
+  char* source; /* copy of the text the hash was taken over */
+  GLint length;
+  unsigned int shader;
+  int references;
+};
+
+static struct {
+  struct RegistryEntry* entries;
+  int count;
+  int capacity;
+  unsigned long compiled;
+  unsigned long shared;
+} shaderRegistry;
+
+/* the object already compiled from source, with another reference; 0 if none */
+unsigned int ShaderRegistry_find(GLenum type, const struct ShaderSource* source)
+{
+  uint64_t hash = registryHash(type, source);
+  for (int i = 0; i < shaderRegistry.count; i++)
+  {
+    struct RegistryEntry* entry = &shaderRegistry.entries[i];
+    /* a 64-bit hash can collide; the bytes decide */
+    if (entry->type == type && entry->hash == hash && entry->length == source->length &&
+        memcmp(entry->source, source->code, (size_t)source->length) == 0)
+    {
+      entry->references++;
+      shaderRegistry.shared++;
+      return entry->shader;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Compiles compiled, the text the driver gets for source, and files it
+ * under source after a ShaderRegistry_find miss. The compile isn't waited
+ * on, so read its status only once the program has been linked.
+*/
+unsigned int ShaderRegistry_add(GLenum type, const struct ShaderSource* source,
+                                const struct ShaderSource* compiled)
+{
+  char* copy = (char*)malloc(source->length > 0 ? (size_t)source->length : 1);
+  if (copy == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(copy, source->code, (size_t)source->length);
+  if (shaderRegistry.count == shaderRegistry.capacity)
+  {
+    int capacity = shaderRegistry.capacity ? 2 * shaderRegistry.capacity : 16;
+    struct RegistryEntry* entries = (struct RegistryEntry*)
+      realloc(shaderRegistry.entries, capacity * sizeof(struct RegistryEntry));
+    if (entries == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderRegistry.entries = entries;
+    shaderRegistry.capacity = capacity;
+  }
+  struct RegistryEntry* entry = &shaderRegistry.entries[shaderRegistry.count++];
+  entry->type = type;
+  entry->hash = registryHash(type, source);
+  entry->source = copy;
+  entry->length = source->length;
+  entry->shader = glCreateShader(type);
+  entry->references = 1;
+  ShaderSource_compile(entry->shader, compiled);
+  shaderRegistry.compiled++;
+  return entry->shader;
+}
+
+/* drops one reference; 0 is ignored */
+void ShaderRegistry_release(unsigned int shader)
+{
+  for (int i = 0; i < shaderRegistry.count; i++)
+  {
+    struct RegistryEntry* entry = &shaderRegistry.entries[i];
+    if (entry->shader != shader || --entry->references > 0)
+      continue;
+    /* programs still holding it as attached keep it alive in the driver */
+    glDeleteShader(shader);
+    free(entry->source);
+    *entry = shaderRegistry.entries[--shaderRegistry.count];
+    if (shaderRegistry.count == 0)
+    {
+      free(shaderRegistry.entries);
+      shaderRegistry.entries = NULL;
+      shaderRegistry.capacity = 0;
+    }
+    return;
+  }
+}
+
+void ShaderRegistry_printStats(void)
+{
+  printf("shader registry: %lu stages compiled, %lu shared, %d alive\n",
+         shaderRegistry.compiled, shaderRegistry.shared, shaderRegistry.count);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+/* FNV-1a over the stage type and the text */
+uint64_t registryHash(GLenum type, const struct ShaderSource* source)
+{
+  uint64_t hash = 14695981039346656037ull;
+  const unsigned char* bytes = (const unsigned char*)&type;
+  for (size_t i = 0; i < sizeof(type); i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  bytes = (const unsigned char*)source->code;
+  for (GLint i = 0; i < source->length; i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+/**
+ * Shader Source
+ * -------------
+ * Maps shader files read-only and hands the mapped pages straight to
+ * glShaderSource with an explicit length, so no heap copy or terminating
+ * '\0' is needed. Where mmap is unavailable the file is read into a single
+ * heap buffer instead.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#ifdef _WIN32
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum ShaderSourceStorage {
+  SHADER_SOURCE_NONE,
+  SHADER_SOURCE_STATIC, /* points at memory owned elsewhere */
+  SHADER_SOURCE_MAPPED,
+  SHADER_SOURCE_HEAP
+};
+
+struct ShaderSource {
+  const char* code; /* not null-terminated, always use length */
+  GLint length;
+  enum ShaderSourceStorage storage;
+};
+
+bool ShaderSource_map(const char* path, struct ShaderSource* source);
+int ShaderSource_mapMany(const char** paths, int count, struct ShaderSource* sources);
+void ShaderSource_release(struct ShaderSource* source);
+void ShaderSource_compile(unsigned int shader, const struct ShaderSource* source);
+size_t ShaderSource_skipBlankAndComments(const char* code, size_t length, size_t at);
+
+bool ShaderSource_map(const char* path, struct ShaderSource* source)
+{
+  source->code = "";
+  source->length = 0;
+  source->storage = SHADER_SOURCE_NONE;
+
+#ifdef _WIN32
+  FILE* file = fopen(path, "rb");
+  struct _stat64 info;
+  if (!file || _fstat64(_fileno(file), &info) != 0)
+  {
+    perror(path);
+    if (file)
+      fclose(file);
+    return false;
+  }
+  if (info.st_size > 0)
+  {
+    char* code = (char*)malloc((size_t)info.st_size);
+    if (code == NULL || fread(code, 1, (size_t)info.st_size, file) != (size_t)info.st_size)
+    {
+      perror(path);
+      free(code);
+      fclose(file);
+      return false;
+    }
+    source->code = code;
+    source->length = (GLint)info.st_size;
+    source->storage = SHADER_SOURCE_HEAP;
+  }
+  else
+    source->storage = SHADER_SOURCE_STATIC;
+  fclose(file);
+#else
+  struct stat info;
+  int fd = open(path, O_RDONLY);
+  if (fd == -1 || fstat(fd, &info) != 0)
+  {
+    perror(path);
+    if (fd != -1)
+      close(fd);
+    return false;
+  }
+  /* mmap rejects zero-length mappings; an empty file is an empty source */
+  if (info.st_size > 0)
+  {
+    void* pages = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pages == MAP_FAILED)
+    {
+      perror(path);
+      close(fd);
+      return false;
+    }
+#ifdef MADV_WILLNEED /* only a hint; strict C without _DEFAULT_SOURCE hides it */
+    madvise(pages, (size_t)info.st_size, MADV_WILLNEED);
+#endif
+    source->code = (const char*)pages;
+    source->length = (GLint)info.st_size;
+    source->storage = SHADER_SOURCE_MAPPED;
+  }
+  else
+    source->storage = SHADER_SOURCE_STATIC;
+  /* the mapping stays valid after the descriptor is gone */
+  close(fd);
+#endif
+  return true;
+}
+
+/**
+ * Maps every file up front so the kernel can read ahead for all of them
+ * before the first one is parsed. Returns how many files mapped; failed
+ * entries are left empty with storage SHADER_SOURCE_NONE.
+*/
+int ShaderSource_mapMany(const char** paths, int count, struct ShaderSource* sources)
+{
+  int mapped = 0;
+  for (int i = 0; i < count; i++)
+    mapped += ShaderSource_map(paths[i], &sources[i]);
+  return mapped;
+}
+
+void ShaderSource_release(struct ShaderSource* source)
+{
+#ifndef _WIN32
+  if (source->storage == SHADER_SOURCE_MAPPED)
+    munmap((void*)source->code, (size_t)source->length);
+#endif
+  if (source->storage == SHADER_SOURCE_HEAP)
+    free((void*)source->code);
+  source->code = "";
+  source->length = 0;
+  source->storage = SHADER_SOURCE_NONE;
+}
+
+void ShaderSource_compile(unsigned int shader, const struct ShaderSource* source)
+{
+  glShaderSource(shader, 1, &source->code, &source->length);
+  glCompileShader(shader);
+}
+
+/* the offset of the first token that isn't whitespace or a comment */
+size_t ShaderSource_skipBlankAndComments(const char* code, size_t length, size_t at)
+{
+  while (at < length)
+  {
+    if (code[at] == ' ' || code[at] == '\t' || code[at] == '\r' || code[at] == '\n')
+      at++;
+    else if (at + 1 < length && code[at] == '/' && code[at + 1] == '/')
+    {
+      const char* end = (const char*)memchr(code + at, '\n', length - at);
+      at = end ? (size_t)(end - code) + 1 : length;
+    }
+    else if (at + 1 < length && code[at] == '/' && code[at + 1] == '*')
+    {
+      at += 2;
+      while (at + 1 < length && !(code[at] == '*' && code[at + 1] == '/'))
+        at++;
+      at = at + 1 < length ? at + 2 : length;
+    }
+    else
+      break;
+  }
+  return at;
+}
+
+#endif
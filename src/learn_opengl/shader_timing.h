@@ -0,0 +1,252 @@
+#ifndef SHADER_TIMING_H
+#define SHADER_TIMING_H
+
+/**
+ * Shader Timing
+ * -------------
+ * Wall-clock time spent in each phase of building a program: reading the
+ * sources, compiling each stage, linking (or loading from the program
+ * cache), the blocking status query and the first glUseProgram. With
+ * parallel compile the compile and link calls only queue work, so the
+ * driver's real cost shows up under status.
+ *
+ * ShaderTiming_printReport prints the total and p95 of every phase. If a
+ * log was opened, it also appends one JSON object per program, tagged with
+ * the GL renderer and version, so runs on different drivers can be compared.
+*/
+#include <glad/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#if !defined(_WIN32) && !defined(CLOCK_MONOTONIC)
+#error "shader_timing.h needs clock_gettime: define _DEFAULT_SOURCE before any system header"
+#endif
+
+enum ShaderTimingPhase {
+  SHADER_TIMING_READ,
+  SHADER_TIMING_VERTEX,
+  SHADER_TIMING_FRAGMENT,
+  SHADER_TIMING_LINK,
+  SHADER_TIMING_STATUS,
+  SHADER_TIMING_FIRST_USE,
+  SHADER_TIMING_PHASES
+};
+
+bool ShaderTiming_open(const char* path);
+double ShaderTiming_now(void);
+int ShaderTiming_begin(bool reload);
+void ShaderTiming_label(int record, const char* vertexPath, const char* fragmentPath);
+void ShaderTiming_add(int record, enum ShaderTimingPhase phase, double milliseconds);
+void ShaderTiming_setCached(int record, bool cached);
+void ShaderTiming_printReport(void);
+/* utility functions */
+static double recordTotal(int record);
+static double percentile95(double* values, int count);
+static int compareDoubles(const void* a, const void* b);
+static void writeJsonString(FILE* file, const char* string);
+
+static const char* shaderTimingPhaseNames[SHADER_TIMING_PHASES] = {
+  "read", "vertex", "fragment", "link", "status", "first_use"
+};
+
+struct ShaderTimingRecord {
+  char* vertex;   /* NULL for sources built from memory */
+  char* fragment;
+  double ms[SHADER_TIMING_PHASES];
+  bool cached;
+  bool reload;
+};
+
+static struct {
+  FILE* log;
+  struct ShaderTimingRecord* records;
+  int count;
+  int capacity;
+} shaderTiming;
+
+/* JSON lines are appended to path; without it only the summary is printed */
+bool ShaderTiming_open(const char* path)
+{
+  shaderTiming.log = fopen(path, "a");
+  if (shaderTiming.log == NULL)
+  {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+/* milliseconds from an arbitrary start, only for differences */
+double ShaderTiming_now(void)
+{
+  struct timespec now;
+#ifdef _WIN32
+  timespec_get(&now, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+  return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+/* a new record with every phase at zero; returns its index */
+int ShaderTiming_begin(bool reload)
+{
+  if (shaderTiming.count == shaderTiming.capacity)
+  {
+    int capacity = shaderTiming.capacity ? 2 * shaderTiming.capacity : 8;
+    struct ShaderTimingRecord* records = (struct ShaderTimingRecord*)
+      realloc(shaderTiming.records, capacity * sizeof(struct ShaderTimingRecord));
+    if (records == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    shaderTiming.records = records;
+    shaderTiming.capacity = capacity;
+  }
+  struct ShaderTimingRecord* record = &shaderTiming.records[shaderTiming.count];
+  memset(record, 0, sizeof(*record));
+  record->reload = reload;
+  return shaderTiming.count++;
+}
+
+void ShaderTiming_label(int record, const char* vertexPath, const char* fragmentPath)
+{
+  struct ShaderTimingRecord* entry = &shaderTiming.records[record];
+  free(entry->vertex);
+  free(entry->fragment);
+  entry->vertex = (char*)malloc(strlen(vertexPath) + 1);
+  entry->fragment = (char*)malloc(strlen(fragmentPath) + 1);
+  if (entry->vertex == NULL || entry->fragment == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(entry->vertex, vertexPath);
+  strcpy(entry->fragment, fragmentPath);
+}
+
+/* records are gone after ShaderTiming_printReport; later calls are dropped */
+void ShaderTiming_add(int record, enum ShaderTimingPhase phase, double milliseconds)
+{
+  if (record < shaderTiming.count)
+    shaderTiming.records[record].ms[phase] += milliseconds;
+}
+
+void ShaderTiming_setCached(int record, bool cached)
+{
+  if (record < shaderTiming.count)
+    shaderTiming.records[record].cached = cached;
+}
+
+/* also writes the records to the log and releases them */
+void ShaderTiming_printReport(void)
+{
+  int count = shaderTiming.count;
+  double* values = (double*)malloc((count > 0 ? count : 1) * sizeof(double));
+  if (values == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (shaderTiming.log)
+  {
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    for (int i = 0; i < count; i++)
+    {
+      const struct ShaderTimingRecord* record = &shaderTiming.records[i];
+      fprintf(shaderTiming.log, "{\"vertex\":");
+      writeJsonString(shaderTiming.log, record->vertex);
+      fprintf(shaderTiming.log, ",\"fragment\":");
+      writeJsonString(shaderTiming.log, record->fragment);
+      fprintf(shaderTiming.log, ",\"reload\":%s,\"cached\":%s",
+              record->reload ? "true" : "false", record->cached ? "true" : "false");
+      for (int phase = 0; phase < SHADER_TIMING_PHASES; phase++)
+        fprintf(shaderTiming.log, ",\"%s_ms\":%.3f", shaderTimingPhaseNames[phase], record->ms[phase]);
+      fprintf(shaderTiming.log, ",\"total_ms\":%.3f,\"renderer\":", recordTotal(i));
+      writeJsonString(shaderTiming.log, renderer);
+      fprintf(shaderTiming.log, ",\"version\":");
+      writeJsonString(shaderTiming.log, version);
+      fprintf(shaderTiming.log, "}\n");
+    }
+    fclose(shaderTiming.log);
+    shaderTiming.log = NULL;
+  }
+
+  printf("shader timing: %d programs\n", count);
+  printf("  %-10s %10s %10s\n", "phase", "total ms", "p95 ms");
+  for (int phase = 0; phase <= SHADER_TIMING_PHASES; phase++)
+  {
+    double total = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+      values[i] = phase < SHADER_TIMING_PHASES ? shaderTiming.records[i].ms[phase] : recordTotal(i);
+      total += values[i];
+    }
+    printf("  %-10s %10.3f %10.3f\n",
+           phase < SHADER_TIMING_PHASES ? shaderTimingPhaseNames[phase] : "total",
+           total, percentile95(values, count));
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    free(shaderTiming.records[i].vertex);
+    free(shaderTiming.records[i].fragment);
+  }
+  free(shaderTiming.records);
+  shaderTiming.records = NULL;
+  shaderTiming.count = shaderTiming.capacity = 0;
+  free(values);
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+double recordTotal(int record)
+{
+  double total = 0.0;
+  for (int phase = 0; phase < SHADER_TIMING_PHASES; phase++)
+    total += shaderTiming.records[record].ms[phase];
+  return total;
+}
+
+/* nearest rank; sorts values in place */
+double percentile95(double* values, int count)
+{
+  if (count == 0)
+    return 0.0;
+  qsort(values, count, sizeof(double), compareDoubles);
+  int rank = (95 * count + 99) / 100;
+  return values[rank - 1];
+}
+
+int compareDoubles(const void* a, const void* b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+void writeJsonString(FILE* file, const char* string)
+{
+  if (string == NULL)
+  {
+    fputs("null", file);
+    return;
+  }
+  fputc('"', file);
+  for (; *string; string++)
+  {
+    if (*string == '"' || *string == '\\')
+      fprintf(file, "\\%c", *string);
+    else if ((unsigned char)*string < 0x20)
+      fprintf(file, "\\u%04x", (unsigned char)*string);
+    else
+      fputc(*string, file);
+  }
+  fputc('"', file);
+}
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+/**
+ * Shader Variants
+ * ---------------
+ * One vertex/fragment pair built many ways. Each bit of a feature mask
+ * injects `#define <feature> 1` right after the `#version` line of both
+ * stages. A variant compiles the first time it is asked for (or in a
+ * batch through ShaderVariants_prewarm), and at most maxLive variants are
+ * kept: the least recently used one is freed to make room. The on-disk
+ * program cache makes bringing an evicted variant back cheap.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "shader.h"
+
+#define SHADER_VARIANTS_MAX_FEATURES 32
+
+typedef struct ShaderVariants_T* ShaderVariants_T;
+
+ShaderVariants_T ShaderVariants_new(const char* vertexPath, const char* fragmentPath,
+                                    const char** features, int featureCount, int maxLive);
+void ShaderVariants_free(ShaderVariants_T variants);
+Shader_T ShaderVariants_get(ShaderVariants_T variants, uint32_t mask);
+bool ShaderVariants_prewarm(ShaderVariants_T variants, const uint32_t* masks, int count);
+int ShaderVariants_liveCount(ShaderVariants_T variants);
+/* utility functions */
+static int findVariant(ShaderVariants_T variants, uint32_t mask);
+static int claimVariantSlot(ShaderVariants_T variants);
+static void buildVariantSource(ShaderVariants_T variants, const struct ShaderSource* base,
+                               uint32_t mask, struct ShaderSource* out);
+
+struct ShaderVariant {
+  uint32_t mask;
+  Shader_T shader; /* NULL if the slot is free */
+  unsigned long lastUsed;
+};
+
+struct ShaderVariants_T {
+  struct ShaderSource vertex; /* heap copies of the expanded base sources */
+  struct ShaderSource fragment;
+  char* features[SHADER_VARIANTS_MAX_FEATURES];
+  int featureCount;
+  struct ShaderVariant* slots;
+  int maxLive;
+  unsigned long clock;
+};
+
+ShaderVariants_T ShaderVariants_new(const char* vertexPath, const char* fragmentPath,
+                                    const char** features, int featureCount, int maxLive)
+{
+  struct ShaderSource loaded[2];
+  const char* paths[2] = { vertexPath, fragmentPath };
+  if (featureCount > SHADER_VARIANTS_MAX_FEATURES || maxLive < 1)
+    return NULL;
+  if (ShaderInclude_loadMany(paths, 2, loaded) != 2)
+  {
+    ShaderSource_release(&loaded[0]);
+    ShaderSource_release(&loaded[1]);
+    return NULL;
+  }
+
+  ShaderVariants_T variants = (ShaderVariants_T)calloc(1, sizeof(struct ShaderVariants_T));
+  if (variants == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  variants->slots = (struct ShaderVariant*)calloc(maxLive, sizeof(struct ShaderVariant));
+  if (variants->slots == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  variants->maxLive = maxLive;
+  variants->featureCount = featureCount;
+  for (int i = 0; i < featureCount; i++)
+    variants->features[i] = copyString(features[i]);
+
+  /* keep private copies; a mapping must not outlive a later edit */
+  struct ShaderSource* copies[2] = { &variants->vertex, &variants->fragment };
+  for (int i = 0; i < 2; i++)
+  {
+    char* code = (char*)malloc(loaded[i].length > 0 ? loaded[i].length : 1);
+    if (code == NULL)
+    {
+      printf("Memory not allocated.\n");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(code, loaded[i].code, loaded[i].length);
+    copies[i]->code = code;
+    copies[i]->length = loaded[i].length;
+    copies[i]->storage = SHADER_SOURCE_HEAP;
+    ShaderSource_release(&loaded[i]);
+  }
+  return variants;
+}
+
+void ShaderVariants_free(ShaderVariants_T variants)
+{
+  for (int i = 0; i < variants->maxLive; i++)
+    if (variants->slots[i].shader)
+      Shader_free(variants->slots[i].shader);
+  for (int i = 0; i < variants->featureCount; i++)
+    free(variants->features[i]);
+  ShaderSource_release(&variants->vertex);
+  ShaderSource_release(&variants->fragment);
+  free(variants->slots);
+  free(variants);
+}
+
+/**
+ * Returns the program for this feature mask, compiling it if needed. The
+ * handle stays valid until a later get or prewarm evicts it, so fetch it
+ * again each frame rather than holding on to it.
+*/
+Shader_T ShaderVariants_get(ShaderVariants_T variants, uint32_t mask)
+{
+  int slot = findVariant(variants, mask);
+  if (slot == -1)
+  {
+    ShaderVariants_prewarm(variants, &mask, 1);
+    slot = findVariant(variants, mask);
+  }
+  variants->slots[slot].lastUsed = ++variants->clock;
+  return variants->slots[slot].shader;
+}
+
+/**
+ * Builds every missing variant in the list as one batch, so the
+ * driver can compile them in parallel during loading. Requested variants
+ * that are already live are kept; at most maxLive distinct masks fit, so
+ * any beyond that are skipped rather than built and evicted at once.
+ * Returns false if any variant was skipped or failed to build.
+*/
+bool ShaderVariants_prewarm(ShaderVariants_T variants, const uint32_t* masks, int count)
+{
+  bool success = true;
+  int missing = 0;
+  uint32_t* pendingMasks = (uint32_t*)malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+  struct ShaderSource* sources =
+    (struct ShaderSource*)malloc(2 * (count > 0 ? count : 1) * sizeof(struct ShaderSource));
+  Shader_T* shaders = (Shader_T*)malloc((count > 0 ? count : 1) * sizeof(Shader_T));
+  if (pendingMasks == NULL || sources == NULL || shaders == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* touched first, so the new variants evict something not asked for */
+  int live = 0;
+  for (int i = 0; i < count; i++)
+  {
+    int slot = findVariant(variants, masks[i]);
+    if (slot != -1 && variants->slots[slot].lastUsed != variants->clock + 1)
+    {
+      variants->slots[slot].lastUsed = variants->clock + 1;
+      live++;
+    }
+  }
+  variants->clock++;
+  for (int i = 0; i < count; i++)
+  {
+    bool duplicate = findVariant(variants, masks[i]) != -1;
+    for (int j = 0; j < missing && !duplicate; j++)
+      duplicate = pendingMasks[j] == masks[i];
+    if (duplicate)
+      continue;
+    if (live + missing == variants->maxLive)
+    {
+      printf("ERROR::SHADER_VARIANTS %d live at most, 0x%x not built\n",
+             variants->maxLive, (unsigned int)masks[i]);
+      success = false;
+      continue;
+    }
+    pendingMasks[missing++] = masks[i];
+  }
+  for (int i = 0; i < missing; i++)
+  {
+    buildVariantSource(variants, &variants->vertex, pendingMasks[i], &sources[i]);
+    buildVariantSource(variants, &variants->fragment, pendingMasks[i], &sources[missing + i]);
+  }
+
+  if (missing > 0)
+    success &= Shader_newBatchFromSources(sources, sources + missing, missing, shaders);
+  for (int i = 0; i < missing; i++)
+  {
+    int slot = claimVariantSlot(variants);
+    variants->slots[slot].mask = pendingMasks[i];
+    variants->slots[slot].shader = shaders[i];
+    variants->slots[slot].lastUsed = ++variants->clock;
+    ShaderSource_release(&sources[i]);
+    ShaderSource_release(&sources[missing + i]);
+  }
+
+  free(shaders);
+  free(sources);
+  free(pendingMasks);
+  return success;
+}
+
+int ShaderVariants_liveCount(ShaderVariants_T variants)
+{
+  int live = 0;
+  for (int i = 0; i < variants->maxLive; i++)
+    live += variants->slots[i].shader != NULL;
+  return live;
+}
+
+/* utility functions */
+/* --------------------------------------------------------------- */
+int findVariant(ShaderVariants_T variants, uint32_t mask)
+{
+  for (int i = 0; i < variants->maxLive; i++)
+    if (variants->slots[i].shader && variants->slots[i].mask == mask)
+      return i;
+  return -1;
+}
+
+/* a free slot, or the least recently used one after freeing its program */
+int claimVariantSlot(ShaderVariants_T variants)
+{
+  int oldest = 0;
+  for (int i = 0; i < variants->maxLive; i++)
+  {
+    if (variants->slots[i].shader == NULL)
+      return i;
+    if (variants->slots[i].lastUsed < variants->slots[oldest].lastUsed)
+      oldest = i;
+  }
+  Shader_free(variants->slots[oldest].shader);
+  variants->slots[oldest].shader = NULL;
+  return oldest;
+}
+
+/* base source with the mask's defines spliced in after #version */
+void buildVariantSource(ShaderVariants_T variants, const struct ShaderSource* base,
+                        uint32_t mask, struct ShaderSource* out)
+{
+  size_t split = 0;
+  size_t length = (size_t)base->length;
+  /* #version has to stay the first statement */
+  size_t first = ShaderSource_skipBlankAndComments(base->code, length, 0);
+  if (length - first >= 8 && strncmp(base->code + first, "#version", 8) == 0)
+  {
+    const char* end = (const char*)memchr(base->code + first, '\n', length - first);
+    split = end ? (size_t)(end - base->code) + 1 : length;
+  }
+
+  size_t definesLength = 32; /* the #line directive */
+  for (int i = 0; i < variants->featureCount; i++)
+    if (mask & (1u << i))
+      definesLength += strlen(variants->features[i]) + 12;
+
+  char* code = (char*)malloc(length + definesLength + 1);
+  if (code == NULL)
+  {
+    printf("Memory not allocated.\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t used = split;
+  memcpy(code, base->code, split);
+  if (split > 0 && code[split - 1] != '\n')
+    code[used++] = '\n';
+  for (int i = 0; i < variants->featureCount; i++)
+    if (mask & (1u << i))
+      used += sprintf(code + used, "#define %s 1\n", variants->features[i]);
+  /* keep driver line numbers matching the file */
+  int line = 1;
+  for (size_t i = 0; i < split; i++)
+    line += base->code[i] == '\n';
+  used += sprintf(code + used, "#line %d 0\n", line);
+  memcpy(code + used, base->code + split, length - split);
+  used += length - split;
+
+  out->code = code;
+  out->length = (GLint)used;
+  out->storage = SHADER_SOURCE_HEAP;
+}
+
+#endif
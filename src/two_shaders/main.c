@@ -4,6 +4,12 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
+#include "geometry_arena.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "pipeline_state.h"
+#include "program_pipeline.h"
+
 /* Global Data */
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -57,66 +63,23 @@ int main() {
 		printf("Failed to initialize GLAD\n");
 		return -1;
 	}
+	GLExt_load((GLADloadfunc)glfwGetProcAddress);
   
 
 	/* Build and compile shader program  */
 	/* --------------------------------- */
-	/* Compile vertex shader source code */
-	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
-
-	check_shader_compile_errors(vertexShader, "VERTEX");
-
-	/* Compile Fragment shader source code */
-	unsigned int fragmentShaderOrange = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShaderOrange, 1, &fragmentShaderOrangeSrc, NULL);
-	glCompileShader(fragmentShaderOrange);
-
-	check_shader_compile_errors(fragmentShaderOrange, "FRAGMENT");
-
-	unsigned int fragmentShaderYellow = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShaderYellow, 1, &fragmentShaderYellowSrc, NULL);
-	glCompileShader(fragmentShaderYellow);
-
-	check_shader_compile_errors(fragmentShaderOrange, "FRAGMENT");
-  
-	/* Link shaders */
-	unsigned int orangeShader, yellowShader;
-	orangeShader = glCreateProgram();
-	glAttachShader(orangeShader, vertexShader);
-	glAttachShader(orangeShader, fragmentShaderOrange);
-	glLinkProgram(orangeShader);
-
-	int success;
-	char infoLog[512];
-	glGetProgramiv(orangeShader, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(orangeShader, 512, NULL, infoLog);
-		printf("ERROR::LINKER::COMPILATION_FAILED\n");
-		printf("%s\n", infoLog);
-
+	/* each stage compiles once; the two programs share the vertex stage */
+	ShaderStage_T vertexStage = ShaderStage_new(GL_VERTEX_SHADER, vertexShaderSource);
+	ShaderStage_T orangeStage = ShaderStage_new(GL_FRAGMENT_SHADER, fragmentShaderOrangeSrc);
+	ShaderStage_T yellowStage = ShaderStage_new(GL_FRAGMENT_SHADER, fragmentShaderYellowSrc);
+	if (vertexStage == NULL || orangeStage == NULL || yellowStage == NULL)
 		exit(1);
-	}
-
-	yellowShader = glCreateProgram();
-	glAttachShader(yellowShader, vertexShader);
-	glAttachShader(yellowShader, fragmentShaderYellow);
-	glLinkProgram(yellowShader);
-	
-	glGetProgramiv(orangeShader, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(yellowShader, 512, NULL, infoLog);
-		printf("ERROR::LINKER::COMPILATION_FAILED\n");
-		printf("%s\n", infoLog);
 
+	/* mix the stages into pipelines, no relink with separate shader objects */
+	ProgramPipeline_T orangeShader = ProgramPipeline_new(vertexStage, orangeStage);
+	ProgramPipeline_T yellowShader = ProgramPipeline_new(vertexStage, yellowStage);
+	if (orangeShader == NULL || yellowShader == NULL)
 		exit(1);
-	}
-
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShaderOrange);
-	glDeleteShader(fragmentShaderYellow);
-
 
 	/* set up vertex data (and buffer(s)) and configure vertex attributes */
 	/* ------------------------------------------------------------------ */
@@ -131,34 +94,27 @@ int main() {
 		0.0f, -0.5f, 0.0f   // bottom left
 	};
 
-	unsigned int VBOs[2], VAOs[2];
-  glGenVertexArrays(2, VAOs);
-	glGenBuffers(2, VBOs);
-	/* first triangle setup */
-	/* -------------------- */
-	glBindVertexArray(VAOs[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(leftTriangle), leftTriangle, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	/* second triangle setup */
-	/* --------------------- */
-	glBindVertexArray(VAOs[1]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(rightTriangle), rightTriangle, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-  /* unbind */
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	// uncomment this call to draw in wireframe polygons
-	// glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	/* both triangles live in one buffer behind one vertex array */
+	const struct VertexAttribute position = { 0, 3, GL_FLOAT, false, 0 };
+	GeometryArena_T arena = GeometryArena_new(&position, 1, 3 * sizeof(float), 1024, 0);
+	struct GeometryMesh leftMesh, rightMesh;
+	GeometryArena_upload(arena, leftTriangle, 3, NULL, 0, &leftMesh);
+	GeometryArena_upload(arena, rightTriangle, 3, NULL, 0, &rightMesh);
+
+	/* everything a draw needs, switched as one state object */
+	struct PipelineStateDesc desc = PipelineState_defaults();
+	// uncomment this line to draw in wireframe polygons
+	// desc.raster.polygonMode = GL_LINE;
+	desc.vertexArray = GeometryArena_vertexArray(arena);
+	ProgramPipeline_describe(orangeShader, &desc);
+	PipelineState_T orangeState = PipelineState_new(&desc);
+	ProgramPipeline_describe(yellowShader, &desc);
+	PipelineState_T yellowState = PipelineState_new(&desc);
 
 	// render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		GLState_beginFrame();
 		// input
 		processInput(window);
 		
@@ -166,13 +122,11 @@ int main() {
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(orangeShader);
-		glBindVertexArray(VAOs[0]);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+    PipelineState_apply(orangeState);
+		GeometryArena_draw(arena, &leftMesh, GL_TRIANGLES);
 
-		glUseProgram(yellowShader);
-		glBindVertexArray(VAOs[1]);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		PipelineState_apply(yellowState);
+		GeometryArena_draw(arena, &rightMesh, GL_TRIANGLES);
 
 		// check and call events and swap the buffers
 		glfwSwapBuffers(window);
@@ -180,10 +134,18 @@ int main() {
 	}
   
 	/* de-allocate all resources, we don't need them anymore */
-	glDeleteVertexArrays(2, VAOs);
-	glDeleteBuffers(2, VBOs);
-	glDeleteProgram(orangeShader);
-	glDeleteProgram(yellowShader);
+	GeometryArena_printStats(arena);
+	GeometryArena_free(arena);
+	PipelineState_free(orangeState);
+	PipelineState_free(yellowState);
+	ProgramPipeline_free(orangeShader);
+	ProgramPipeline_free(yellowShader);
+	ShaderStage_free(vertexStage);
+	ShaderStage_free(orangeStage);
+	ShaderStage_free(yellowStage);
+	ProgramPipeline_printStats();
+	PipelineState_printStats();
+	GLState_printStats();
 	
 	glfwTerminate();
   return 0;
@@ -9,6 +9,10 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
+#include "geometry_arena.h"
+#include "gl_state.h"
+#include "pipeline_state.h"
+
 /* Global Data */
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -108,31 +112,23 @@ int main() {
 		0, 1, 2,  // first triangle
 		2, 3, 4   // second triangle
 	};
-	unsigned int VBO, VAO, EBO;
-  glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-	
-	glBindVertexArray(VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	// uncomment this call to draw in wireframe polygons
-	// glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	/* vertices and indices suballocated from the arena's shared buffers */
+	const struct VertexAttribute position = { 0, 3, GL_FLOAT, false, 0 };
+	GeometryArena_T arena = GeometryArena_new(&position, 1, 3 * sizeof(float), 1024, 4096);
+	struct GeometryMesh triangles;
+	GeometryArena_upload(arena, vertices, 5, indices, 6, &triangles);
+
+	struct PipelineStateDesc desc = PipelineState_defaults();
+	desc.program = shaderProgram;
+	desc.vertexArray = GeometryArena_vertexArray(arena);
+	// uncomment this line to draw in wireframe polygons
+	// desc.raster.polygonMode = GL_LINE;
+	PipelineState_T triangleState = PipelineState_new(&desc);
 
 	// render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		GLState_beginFrame();
 		// input
 		processInput(window);
 		
@@ -140,9 +136,8 @@ int main() {
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    PipelineState_apply(triangleState);
+		GeometryArena_draw(arena, &triangles, GL_TRIANGLES);
 
 		// check and call events and swap the buffers
 		glfwSwapBuffers(window);
@@ -150,10 +145,12 @@ int main() {
 	}
   
 	/* de-allocate all resources, we don't need them anymore */
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	GeometryArena_printStats(arena);
+	GeometryArena_free(arena);
 	glDeleteProgram(shaderProgram);
+	PipelineState_free(triangleState);
+	PipelineState_printStats();
+	GLState_printStats();
 	
 	glfwTerminate();
   return 0;
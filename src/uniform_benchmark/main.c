@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+
+#include "gl_ext.h"
+#include "../learn_opengl/shader.h"
+
+/**
+ * Uniform Benchmark
+ * -----------------
+ * Times a frame's worth of uniform sets three ways: asking the driver for
+ * every location (glGetUniformLocation + glUniform1f, the old Shader_set*),
+ * Shader_setFloat by name through the reflected table, and Shader_setFloatAt
+ * through handles resolved once. Values change every frame so no set is
+ * skipped as redundant. Prints the average CPU time per frame.
+*/
+
+/* Global Data */
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const int FRAMES = 2000;
+
+#define UNIFORM_COUNT 16
+
+const char* vertexShaderSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"void main()\n"
+"{\n"
+"	 gl_Position = vec4(aPos, 1.0);\n"
+"}\n";
+
+/* every uniform has to be used or the linker drops it */
+const char* fragmentShaderSource = "#version 330 core\n"
+"uniform float ambient;\n"
+"uniform float diffuse;\n"
+"uniform float specular;\n"
+"uniform float shininess;\n"
+"uniform float exposure;\n"
+"uniform float gamma;\n"
+"uniform float fogNear;\n"
+"uniform float fogFar;\n"
+"uniform float weights[8];\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"	 float sum = ambient + diffuse + specular + shininess + exposure + gamma + fogNear + fogFar;\n"
+"	 for (int i = 0; i < 8; i++)\n"
+"	   sum += weights[i];\n"
+"	 FragColor = vec4(sum);\n"
+"}\n";
+
+const char* uniformNames[UNIFORM_COUNT] = {
+	"ambient", "diffuse", "specular", "shininess",
+	"exposure", "gamma", "fogNear", "fogFar",
+	"weights[0]", "weights[1]", "weights[2]", "weights[3]",
+	"weights[4]", "weights[5]", "weights[6]", "weights[7]",
+};
+
+/* Pototypes */
+double benchmarkDriverLookup(Shader_T sh);
+double benchmarkByName(Shader_T sh);
+double benchmarkByHandle(Shader_T sh);
+
+/* Functions */
+int main() {
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Uniform Benchmark", NULL, NULL);
+	if (window == NULL)
+	{
+		printf("Failed to create GLFW window\n");
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	/* Initialize GLAD to call OpenGL functions */
+	if (!gladLoadGL((GLADloadfunc)glfwGetProcAddress))
+	{
+		printf("Failed to initialize GLAD\n");
+		return -1;
+	}
+	GLExt_load((GLADloadfunc)glfwGetProcAddress);
+
+	Shader_T sh = Shader_newFromMemory(vertexShaderSource, strlen(vertexShaderSource),
+	                                   fragmentShaderSource, strlen(fragmentShaderSource));
+	Shader_use(sh);
+
+	double driver = benchmarkDriverLookup(sh);
+	double byName = benchmarkByName(sh);
+	double byHandle = benchmarkByHandle(sh);
+	printf("%d uniforms a frame, %d frames\n", UNIFORM_COUNT, FRAMES);
+	printf("  glGetUniformLocation  %8.3f us/frame\n", driver);
+	printf("  Shader_setFloat       %8.3f us/frame (%.1fx)\n", byName, driver / byName);
+	printf("  Shader_setFloatAt     %8.3f us/frame (%.1fx)\n", byHandle, driver / byHandle);
+
+	Shader_free(sh);
+	glfwTerminate();
+  return 0;
+}
+
+/* the driver round trip every Shader_set* used to make */
+double benchmarkDriverLookup(Shader_T sh)
+{
+	glFinish();
+	double start = glfwGetTime();
+	for (int frame = 0; frame < FRAMES; frame++)
+		for (int i = 0; i < UNIFORM_COUNT; i++)
+			glUniform1f(glGetUniformLocation(sh->ID, uniformNames[i]), (float)(frame + i));
+	glFinish();
+	return (glfwGetTime() - start) * 1e6 / FRAMES;
+}
+
+double benchmarkByName(Shader_T sh)
+{
+	glFinish();
+	double start = glfwGetTime();
+	for (int frame = 0; frame < FRAMES; frame++)
+		for (int i = 0; i < UNIFORM_COUNT; i++)
+			Shader_setFloat(sh, uniformNames[i], (float)(frame + i));
+	glFinish();
+	return (glfwGetTime() - start) * 1e6 / FRAMES;
+}
+
+double benchmarkByHandle(Shader_T sh)
+{
+	ShaderUniform handles[UNIFORM_COUNT];
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+		handles[i] = Shader_uniform(sh, uniformNames[i]);
+	glFinish();
+	double start = glfwGetTime();
+	for (int frame = 0; frame < FRAMES; frame++)
+		for (int i = 0; i < UNIFORM_COUNT; i++)
+			Shader_setFloatAt(sh, handles[i], (float)(frame + i));
+	glFinish();
+	return (glfwGetTime() - start) * 1e6 / FRAMES;
+}